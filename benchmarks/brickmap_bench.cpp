@@ -0,0 +1,195 @@
+// Brickmap query microbenchmark against a dense bool[32^3] baseline.
+// Build with -DZENIX_BUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run brickmap_bench.
+
+#include "brickmap.hpp"
+#include "SimplexNoise.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+using zx::Brickmap;
+
+namespace {
+
+constexpr int EDGE = Brickmap::EDGE;
+
+// dense baseline, one byte per voxel laid out like Chunk::voxelIndex
+struct DenseGrid {
+  std::array<uint8_t, EDGE * EDGE * EDGE> voxels{};
+
+  bool isSolid(int x, int y, int z) const { return voxels[(y * EDGE + z) * EDGE + x] != 0; }
+
+  // plain voxel DDA over every cell, no empty space skipping
+  bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, Brickmap::RaycastHit &hit)
+      const {
+    float length = glm::length(direction);
+    if (length <= 0.f) return false;
+    direction /= length;
+
+    const float inf = std::numeric_limits<float>::infinity();
+    float tEnter = 0.f;
+    float tExit = maxDistance;
+    for (int a = 0; a < 3; a++) {
+      if (direction[a] == 0.f) {
+        if (origin[a] < 0.f || origin[a] > static_cast<float>(EDGE)) return false;
+        continue;
+      }
+      float t0 = (0.f - origin[a]) / direction[a];
+      float t1 = (static_cast<float>(EDGE) - origin[a]) / direction[a];
+      if (t0 > t1) std::swap(t0, t1);
+      tEnter = std::max(tEnter, t0);
+      tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit) return false;
+
+    glm::vec3 p = origin + direction * tEnter;
+    glm::ivec3 cell{};
+    glm::ivec3 step{};
+    glm::vec3 tMax{};
+    glm::vec3 tDelta{};
+    for (int a = 0; a < 3; a++) {
+      cell[a] = std::clamp(static_cast<int>(std::floor(p[a])), 0, EDGE - 1);
+      if (direction[a] > 0.f) {
+        step[a] = 1;
+        tMax[a] = (cell[a] + 1 - origin[a]) / direction[a];
+        tDelta[a] = 1.f / direction[a];
+      } else if (direction[a] < 0.f) {
+        step[a] = -1;
+        tMax[a] = (cell[a] - origin[a]) / direction[a];
+        tDelta[a] = -1.f / direction[a];
+      } else {
+        step[a] = 0;
+        tMax[a] = inf;
+        tDelta[a] = inf;
+      }
+    }
+
+    float t = tEnter;
+    while (t <= tExit) {
+      if (isSolid(cell.x, cell.y, cell.z)) {
+        hit.voxel = cell;
+        hit.distance = t;
+        return true;
+      }
+      int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+      t = tMax[axis];
+      cell[axis] += step[axis];
+      if (cell[axis] < 0 || cell[axis] >= EDGE) break;
+      tMax[axis] += tDelta[axis];
+    }
+    return false;
+  }
+};
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+};
+
+// same height field as Chunk::intializeChunk for the chunk at the world origin
+template <typename Set>
+void fillTerrain(Set &&set) {
+  for (int z = 0; z < EDGE; z++) {
+    for (int x = 0; x < EDGE; x++) {
+      int n = int(((SimplexNoise::noise(static_cast<float>(x), static_cast<float>(z)) + 1.f) / 2.f) * 32.f);
+      float h = n / 2.f;
+      for (int y = 0; y < EDGE; y++) set(x, y, z, static_cast<float>(y) < h);
+    }
+  }
+}
+
+template <typename Fn>
+double nsPerOp(int ops, Fn &&fn) {
+  // one warm up pass, then keep the fastest of a few runs
+  fn();
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / ops);
+  }
+  return best;
+}
+
+void report(const char *name, double brickmapNs, double denseNs) {
+  std::printf("%-28s brickmap %7.2f ns  dense %7.2f ns  (%.2fx)\n", name, brickmapNs, denseNs,
+      denseNs / brickmapNs);
+}
+
+}  // namespace
+
+int main() {
+  Brickmap brickmap;
+  DenseGrid dense;
+  fillTerrain([&](int x, int y, int z, bool solid) {
+    brickmap.set(x, y, z, solid);
+    dense.voxels[(y * EDGE + z) * EDGE + x] = solid;
+  });
+
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<int> coord{0, EDGE - 1};
+  std::uniform_real_distribution<float> unit{-1.f, 1.f};
+
+  constexpr int LOOKUPS = 1 << 20;
+  std::vector<glm::ivec3> points(LOOKUPS);
+  for (auto &p : points) p = glm::ivec3{coord(rng), coord(rng), coord(rng)};
+
+  // rays start above the terrain and look down at it, plus rays that skim across the chunk
+  constexpr int RAYS = 1 << 16;
+  std::vector<Ray> downRays(RAYS);
+  std::vector<Ray> skimRays(RAYS);
+  for (auto &r : downRays) {
+    r.origin = glm::vec3{coord(rng) + .5f, EDGE - .5f, coord(rng) + .5f};
+    r.direction = glm::vec3{unit(rng) * .5f, -1.f, unit(rng) * .5f};
+  }
+  for (auto &r : skimRays) {
+    r.origin = glm::vec3{0.f, EDGE - 4.f + unit(rng) * 4.f, coord(rng) + .5f};
+    r.direction = glm::vec3{1.f, unit(rng) * .1f, unit(rng) * .5f};
+  }
+
+  // both structures must agree or the comparison is meaningless
+  int mismatches = 0;
+  for (auto &p : points) mismatches += brickmap.isSolid(p.x, p.y, p.z) != dense.isSolid(p.x, p.y, p.z);
+  for (auto *rays : {&downRays, &skimRays}) {
+    for (auto &r : *rays) {
+      Brickmap::RaycastHit a, b;
+      bool hitA = brickmap.raycast(r.origin, r.direction, 100.f, a);
+      bool hitB = dense.raycast(r.origin, r.direction, 100.f, b);
+      mismatches += hitA != hitB || (hitA && a.voxel != b.voxel);
+    }
+  }
+  if (mismatches != 0) {
+    std::printf("brickmap and dense grid disagree on %d queries\n", mismatches);
+    return 1;
+  }
+
+  volatile int sink = 0;
+  auto lookups = [&](auto &grid) {
+    return nsPerOp(LOOKUPS, [&] {
+      int solid = 0;
+      for (auto &p : points) solid += grid.isSolid(p.x, p.y, p.z);
+      sink = sink + solid;
+    });
+  };
+  auto raycasts = [&](auto &grid, const std::vector<Ray> &rays) {
+    return nsPerOp(RAYS, [&] {
+      int hits = 0;
+      Brickmap::RaycastHit hit;
+      for (auto &r : rays) hits += grid.raycast(r.origin, r.direction, 100.f, hit);
+      sink = sink + hits;
+    });
+  };
+
+  std::printf("terrain chunk, %d lookups, %d rays per set\n", LOOKUPS, RAYS);
+  report("isSolid (random)", lookups(brickmap), lookups(dense));
+  report("raycast (down at terrain)", raycasts(brickmap, downRays), raycasts(dense, downRays));
+  report("raycast (skimming)", raycasts(brickmap, skimRays), raycasts(dense, skimRays));
+  return 0;
+}
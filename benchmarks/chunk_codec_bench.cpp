@@ -0,0 +1,98 @@
+// ChunkCodec ratio and throughput on generated terrain chunks.
+// Build with -DZENIX_BUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run chunk_codec_bench.
+
+#include "chunk_codec.hpp"
+#include "SimplexNoise.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+using zx::ChunkCodec;
+
+namespace {
+
+constexpr int SIZE = 32;
+
+// same terrain as Chunk::intializeChunk: stone up to the height field, one layer of grass, air above
+std::vector<uint8_t> generateChunk(int originX, int originY, int originZ) {
+  std::vector<uint8_t> types(ChunkCodec::CHUNK_VOLUME);
+  for (int z = 0; z < SIZE; z++) {
+    for (int x = 0; x < SIZE; x++) {
+      float noise = SimplexNoise::noise(static_cast<float>(originX + x), static_cast<float>(originZ + z));
+      float height = int(((noise + 1.f) / 2.f) * 32.f) / 2.f;
+      for (int y = 0; y < SIZE; y++) {
+        float wy = static_cast<float>(originY + y);
+        types[(y * SIZE + z) * SIZE + x] = wy < height ? (wy + 1 < height ? 1 : 2) : 0;
+      }
+    }
+  }
+  return types;
+}
+
+template <typename Fn>
+double bestSeconds(Fn &&fn) {
+  fn();
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best;
+}
+
+void run(const char *name, const std::vector<std::vector<uint8_t>> &chunks) {
+  std::vector<std::vector<uint8_t>> payloads;
+  size_t rawBytes = 0;
+  size_t packedBytes = 0;
+  for (auto &chunk : chunks) {
+    payloads.push_back(ChunkCodec::encode(chunk.data(), chunk.size()));
+    rawBytes += chunk.size();
+    packedBytes += payloads.back().size();
+  }
+
+  std::vector<uint8_t> types;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (!ChunkCodec::decode(payloads[i].data(), payloads[i].size(), types) || types != chunks[i]) {
+      std::printf("%s: chunk %zu does not round trip\n", name, i);
+      return;
+    }
+  }
+
+  double encodeSeconds = bestSeconds([&] {
+    for (auto &chunk : chunks) ChunkCodec::encode(chunk.data(), chunk.size());
+  });
+  double decodeSeconds = bestSeconds([&] {
+    for (auto &payload : payloads) ChunkCodec::decode(payload.data(), payload.size(), types);
+  });
+
+  double gb = static_cast<double>(rawBytes) / 1e9;
+  std::printf("%-16s %4zu chunks  ratio %7.1fx  %6zu B/chunk  encode %5.2f GB/s  decode %5.2f GB/s\n",
+      name, chunks.size(), static_cast<double>(rawBytes) / packedBytes, packedBytes / chunks.size(),
+      gb / encodeSeconds, gb / decodeSeconds);
+}
+
+}  // namespace
+
+int main() {
+  // terrain never rises above 16 voxels, so every surface chunk sits at y = 0
+  std::vector<std::vector<uint8_t>> surface;
+  std::vector<std::vector<uint8_t>> column;
+  for (int cz = 0; cz < 16; cz++) {
+    for (int cx = 0; cx < 16; cx++) {
+      surface.push_back(generateChunk(cx * SIZE, 0, cz * SIZE));
+      // a region column is COLUMN_HEIGHT chunks, the seven above the surface are all air
+      for (int cy = 0; cy < 8 && cz < 2; cy++) column.push_back(generateChunk(cx * SIZE, cy * SIZE, cz * SIZE));
+    }
+  }
+  std::vector<std::vector<uint8_t>> solid(64, std::vector<uint8_t>(ChunkCodec::CHUNK_VOLUME, 1));
+
+  run("surface chunks", surface);
+  run("region columns", column);
+  run("solid chunks", solid);
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Blocky and surface nets chunk meshing compared on the same terrain chunks, at every LOD.
+// Times include MeshOptimizer where the mesher runs it, ACMR is after it (before in brackets).
+// Build with -DZENIX_BUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run chunk_mesher_bench.
+
+#include "chunk_mesher.hpp"
+#include "SimplexNoise.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+using zx::ChunkMesher;
+
+namespace {
+
+constexpr int SIZE = ChunkMesher::SIZE;
+
+struct TerrainChunk {
+  glm::ivec3 origin{};
+  std::vector<zx::Voxel> voxels;
+  zx::Brickmap brickmap{};
+};
+
+// same terrain as Chunk::intializeChunk: stone up to the height field, one layer of grass, air above
+TerrainChunk generateChunk(glm::ivec3 origin) {
+  TerrainChunk chunk;
+  chunk.origin = origin;
+  chunk.voxels.resize(SIZE * SIZE * SIZE);
+  for (int z = 0; z < SIZE; z++) {
+    for (int x = 0; x < SIZE; x++) {
+      float noise = SimplexNoise::noise(static_cast<float>(origin.x + x), static_cast<float>(origin.z + z));
+      float height = int(((noise + 1.f) / 2.f) * 32.f) / 2.f;
+      for (int y = 0; y < SIZE; y++) {
+        float wy = static_cast<float>(origin.y + y);
+        zx::VoxelType type = wy < height ? (wy + 1 < height ? zx::stone : zx::grass) : zx::air;
+        chunk.voxels[(y * SIZE + z) * SIZE + x].type = type;
+        chunk.brickmap.set(x, y, z, type != zx::air);
+      }
+    }
+  }
+  return chunk;
+}
+
+template <typename Fn>
+double bestSeconds(Fn &&fn) {
+  fn();
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best;
+}
+
+void run(const char *name, ChunkMesher::Mesher mesher, int lod, const std::vector<TerrainChunk> &chunks) {
+  std::vector<ChunkMesher::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  size_t vertexCount = 0;
+  size_t triangleCount = 0;
+  double acmrBefore = 0.0;
+  double acmrAfter = 0.0;
+  for (auto &chunk : chunks) {
+    zx::MeshOptimizer::Stats stats =
+        ChunkMesher::build(mesher, lod, chunk.origin, chunk.brickmap, chunk.voxels.data(), vertices, indices);
+    vertexCount += vertices.size();
+    triangleCount += indices.size() / 3;
+    // blocky meshes are not optimized, their ACMR is what gets drawn
+    float acmr = stats.acmrBefore > 0.f ? stats.acmrAfter : zx::MeshOptimizer::acmr(indices);
+    acmrBefore += stats.acmrBefore > 0.f ? stats.acmrBefore : acmr;
+    acmrAfter += acmr;
+  }
+
+  double seconds = bestSeconds([&] {
+    for (auto &chunk : chunks) {
+      ChunkMesher::build(mesher, lod, chunk.origin, chunk.brickmap, chunk.voxels.data(), vertices, indices);
+    }
+  });
+
+  size_t bytes = vertexCount * sizeof(ChunkMesher::Vertex) + triangleCount * 3 * sizeof(uint32_t);
+  std::printf("%-13s LOD %d  %8.3f ms/chunk  %7zu triangles/chunk  %6zu vertices/chunk  %7.1f KiB/chunk  ACMR %.3f (%.3f)\n",
+      name, lod, seconds * 1e3 / chunks.size(), triangleCount / chunks.size(), vertexCount / chunks.size(),
+      bytes / 1024.0 / chunks.size(), acmrAfter / chunks.size(), acmrBefore / chunks.size());
+}
+
+}  // namespace
+
+int main() {
+  // terrain never rises above 16 voxels, so every surface chunk sits at y = 0
+  std::vector<TerrainChunk> chunks;
+  for (int cz = 0; cz < 8; cz++) {
+    for (int cx = 0; cx < 8; cx++) chunks.push_back(generateChunk(glm::ivec3{cx, 0, cz} * SIZE));
+  }
+
+  std::printf("%zu surface chunks\n", chunks.size());
+  for (int lod = 0; lod < ChunkMesher::LOD_COUNT; lod++) {
+    run("blocky", ChunkMesher::Mesher::blocky, lod, chunks);
+    run("surface nets", ChunkMesher::Mesher::surfaceNets, lod, chunks);
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+#version 450
+
+layout (location = 0) in vec3 frag_color;
+layout (location = 1) in vec3 frag_normal;
+layout (location = 2) in vec2 frag_world_xz;
+
+layout (location = 0) out vec4 out_color;
+
+layout(push_constant) uniform Push {
+  vec4 hole;
+  ivec2 origin;
+  float spacing;
+  int level;
+} push;
+
+void main() {
+  // the inside of the hole is drawn by a finer level or by the voxel chunks
+  if (all(greaterThan(frag_world_xz, push.hole.xy)) && all(lessThan(frag_world_xz, push.hole.zw))) {
+    discard;
+  }
+  out_color = vec4(max(dot(normalize(vec3(-1.f, -1.f, -1.f)), normalize(frag_normal)), 0.f) * frag_color, 1.f);
+}
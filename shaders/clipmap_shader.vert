@@ -0,0 +1,51 @@
+#version 450
+
+layout (location = 0) out vec3 frag_color;
+layout (location = 1) out vec3 frag_normal;
+layout (location = 2) out vec2 frag_world_xz;
+
+layout(push_constant) uniform Push {
+  vec4 hole;
+  ivec2 origin;
+  float spacing;
+  int level;
+} push;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 inverseProjection;
+  mat4 view;
+  mat4 inverseView;
+  vec3 cameraPositon;
+  float dt;
+} ubo;
+
+layout(set = 1, binding = 0) readonly buffer Heights {
+  float heights[];
+};
+
+const int GRID = 64;
+
+// heights are stored toroidally, logical vertex (i, j) of the level lives in slot ((origin + ij) mod GRID)
+float heightAt(int i, int j) {
+  i = clamp(i, 0, GRID - 1);
+  j = clamp(j, 0, GRID - 1);
+  int slotX = (push.origin.x + i) & (GRID - 1);
+  int slotZ = (push.origin.y + j) & (GRID - 1);
+  return heights[push.level * GRID * GRID + slotZ * GRID + slotX];
+}
+
+void main() {
+  int i = gl_VertexIndex % GRID;
+  int j = gl_VertexIndex / GRID;
+
+  vec3 positionWorld = vec3(float(push.origin.x + i) * push.spacing, heightAt(i, j), float(push.origin.y + j) * push.spacing);
+  gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.f);
+  gl_Position.y = -gl_Position.y;
+
+  float dx = (heightAt(i + 1, j) - heightAt(i - 1, j)) / (2.f * push.spacing);
+  float dz = (heightAt(i, j + 1) - heightAt(i, j - 1)) / (2.f * push.spacing);
+  frag_normal = normalize(vec3(-dx, 1.f, -dz));
+  frag_color = vec3(0.4f, 0.4f, 0.4f);
+  frag_world_xz = positionWorld.xz;
+}
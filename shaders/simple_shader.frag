@@ -1,14 +1,12 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 frag_color;
+layout (location = 1) in vec2 frag_uv;
+layout (location = 2) flat in uint frag_texture_index;
 
 layout (location = 0) out vec4 out_color;
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} push;
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 inverseProjection;
@@ -18,8 +16,9 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   float dt;
 } ubo;
 
-layout(set = 0, binding = 2) uniform sampler2D image;
+// every texture of the bindless set, instances of one draw may pick different ones
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 void main() {
-  out_color = vec4(frag_color, 1.f);
-}
\ No newline at end of file
+  out_color = vec4(frag_color, 1.f) * texture(textures[nonuniformEXT(frag_texture_index)], frag_uv);
+}
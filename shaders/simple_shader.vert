@@ -4,13 +4,21 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 uv;
+layout (location = 4) in uint objectIndex;
 
 layout (location = 0) out vec3 frag_color;
+layout (location = 1) out vec2 frag_uv;
+layout (location = 2) flat out uint frag_texture_index;
 
-layout(push_constant) uniform Push {
+struct ObjectData {
   mat4 modelMatrix;
   mat4 normalMatrix;
-} push;
+  uint textureIndex;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer ObjectBuffer {
+  ObjectData objects[];
+} objectBuffer;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
@@ -26,10 +34,12 @@ float rand(vec2 seed){
 }
 
 void main() {
-  vec4 positionWorld = push.modelMatrix /*to world space*/ * vec4(position, 1.f) /*NDC space*/;
+  vec4 positionWorld = objectBuffer.objects[objectIndex].modelMatrix /*to world space*/ * vec4(position, 1.f) /*NDC space*/;
   //               finally                        <--  then                      <--   first
   gl_Position = ubo.projection /*to screen space*/ * ubo.view /*to camera space*/ * positionWorld /*world space*/;
   frag_color = vec3(color);
+  frag_uv = uv;
+  frag_texture_index = objectBuffer.objects[objectIndex].textureIndex;
 }
 
                               /*          NDC Space
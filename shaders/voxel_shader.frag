@@ -1,15 +1,11 @@
 #version 450
 
-layout (location = 0) in vec3 frag_color;
+layout (location = 0) in vec3 frag_position;
 layout (location = 1) in vec3 frag_normal;
+layout (location = 2) flat in uint frag_block_id;
 
 layout (location = 0) out vec4 out_color;
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} push;
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 inverseProjection;
@@ -19,11 +15,13 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   float dt;
 } ubo;
 
-layout(set = 0, binding = 2) uniform sampler2D image;
+// one layer per solid block type, air has none
+layout(set = 1, binding = 0) uniform sampler2DArray blockTextures;
 
 void main() {
-  if(abs((vec3(0.8f, 0.2f, 0.25f) - frag_color).x) < 0.05f) {
-    discard;
-  }
-  out_color = vec4(max(dot(normalize(vec3(-1.f, -1.f, -1.f)), frag_normal), 0.f) * frag_color, 1.f);
-}
\ No newline at end of file
+  // projected along the dominant axis of the normal, faces need no uvs of their own
+  vec3 n = abs(frag_normal);
+  vec2 uv = n.x > n.y && n.x > n.z ? frag_position.zy : (n.y > n.z ? frag_position.xz : frag_position.xy);
+  vec3 albedo = texture(blockTextures, vec3(uv, float(frag_block_id - 1u))).rgb;
+  out_color = vec4(max(dot(normalize(vec3(-1.f, -1.f, -1.f)), frag_normal), 0.f) * albedo, 1.f);
+}
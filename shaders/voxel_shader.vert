@@ -1,16 +1,22 @@
 #version 450
 
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 color;
+layout (location = 1) in uint blockId;
 layout (location = 2) in vec3 normal;
 
-layout (location = 0) out vec3 frag_color;
+layout (location = 0) out vec3 frag_position;
 layout (location = 1) out vec3 frag_normal;
+layout (location = 2) flat out uint frag_block_id;
 
-layout(push_constant) uniform Push {
+struct ObjectData {
   mat4 modelMatrix;
   mat4 normalMatrix;
-} push;
+  uint textureIndex;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer ObjectBuffer {
+  ObjectData objects[];
+} objectBuffer;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
@@ -26,12 +32,14 @@ float rand(vec2 seed){
 }
 
 void main() {
-  vec4 positionWorld = push.modelMatrix /*to world space*/ * vec4(position.x, position.y, position.z, 1.f) /*NDC space*/;
+  vec4 positionWorld = objectBuffer.objects[gl_InstanceIndex].modelMatrix /*to world space*/ * vec4(position.x, position.y, position.z, 1.f) /*NDC space*/;
   //               finally                        <--  then                      <--   first
   gl_Position = ubo.projection /*to screen space*/ * ubo.view /*to camera space*/ * positionWorld /*world space*/;
   gl_Position.y = -gl_Position.y;
-  frag_color = color;
+  // chunk space, one texture repeat per voxel
+  frag_position = position;
   frag_normal = normal;
+  frag_block_id = blockId;
 }
 
                               /*          NDC Space
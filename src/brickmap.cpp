@@ -0,0 +1,233 @@
+#include "brickmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace zx {
+
+namespace {
+// Amanatides & Woo grid walk over cells of size cellSize in [lo, hi], starting at tEnter.
+// visit(cell, t, normal) returns true to stop the walk.
+template <typename Visitor>
+bool traverseGrid(
+    glm::vec3 origin,
+    glm::vec3 direction,
+    float cellSize,
+    glm::ivec3 lo,
+    glm::ivec3 hi,
+    float tEnter,
+    float tExit,
+    glm::ivec3 normal,
+    Visitor &&visit) {
+  const float inf = std::numeric_limits<float>::infinity();
+  glm::vec3 p = origin + direction * tEnter;
+
+  glm::ivec3 cell{};
+  glm::ivec3 step{};
+  glm::vec3 tMax{};
+  glm::vec3 tDelta{};
+  for (int a = 0; a < 3; a++) {
+    cell[a] = std::clamp(static_cast<int>(std::floor(p[a] / cellSize)), lo[a], hi[a]);
+    if (direction[a] > 0.f) {
+      step[a] = 1;
+      tMax[a] = ((cell[a] + 1) * cellSize - origin[a]) / direction[a];
+      tDelta[a] = cellSize / direction[a];
+    } else if (direction[a] < 0.f) {
+      step[a] = -1;
+      tMax[a] = (cell[a] * cellSize - origin[a]) / direction[a];
+      tDelta[a] = -cellSize / direction[a];
+    } else {
+      step[a] = 0;
+      tMax[a] = inf;
+      tDelta[a] = inf;
+    }
+  }
+
+  float t = tEnter;
+  while (t <= tExit) {
+    if (visit(cell, t, normal)) return true;
+
+    int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+    t = tMax[axis];
+    cell[axis] += step[axis];
+    if (cell[axis] < lo[axis] || cell[axis] > hi[axis]) break;
+    normal = glm::ivec3{0, 0, 0};
+    normal[axis] = -step[axis];
+    tMax[axis] += tDelta[axis];
+  }
+  return false;
+}
+}  // namespace
+
+void Brickmap::clear() {
+  for (auto &brick : bricks) brick.fill(0);
+  solidCounts.fill(0);
+  occupiedMask = 0;
+  fullMask = 0;
+}
+
+void Brickmap::set(int x, int y, int z, bool solid) {
+  int brick = brickIndex(x / BRICK_EDGE, y / BRICK_EDGE, z / BRICK_EDGE);
+  uint64_t &layer = bricks[brick][y % BRICK_EDGE];
+  uint64_t bit = 1ull << ((z % BRICK_EDGE) * BRICK_EDGE + (x % BRICK_EDGE));
+
+  if (((layer & bit) != 0) == solid) return;
+
+  if (solid) {
+    layer |= bit;
+    solidCounts[brick]++;
+  } else {
+    layer &= ~bit;
+    solidCounts[brick]--;
+  }
+
+  uint64_t brickBit = 1ull << brick;
+  occupiedMask = solidCounts[brick] > 0 ? occupiedMask | brickBit : occupiedMask & ~brickBit;
+  fullMask = solidCounts[brick] == BRICK_VOLUME ? fullMask | brickBit : fullMask & ~brickBit;
+}
+
+bool Brickmap::isBrickBuried(int bx, int by, int bz) const {
+  if (!isBrickFull(brickIndex(bx, by, bz))) return false;
+
+  static const int offsets[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+  for (auto &o : offsets) {
+    int nx = bx + o[0], ny = by + o[1], nz = bz + o[2];
+    // neighbouring chunks are unknown here, so bricks on the chunk border always count as exposed
+    if (nx < 0 || ny < 0 || nz < 0 || nx >= BRICKS_PER_AXIS || ny >= BRICKS_PER_AXIS ||
+        nz >= BRICKS_PER_AXIS) {
+      return false;
+    }
+    if (!isBrickFull(brickIndex(nx, ny, nz))) return false;
+  }
+  return true;
+}
+
+bool Brickmap::isRegionEmpty(glm::ivec3 min, glm::ivec3 max) const {
+  min = glm::clamp(min, glm::ivec3{0}, glm::ivec3{EDGE});
+  max = glm::clamp(max, glm::ivec3{0}, glm::ivec3{EDGE});
+  if (min.x >= max.x || min.y >= max.y || min.z >= max.z || occupiedMask == 0) return true;
+
+  glm::ivec3 brickMin = min / BRICK_EDGE;
+  glm::ivec3 brickMax = (max - glm::ivec3{1}) / BRICK_EDGE;
+  for (int by = brickMin.y; by <= brickMax.y; by++) {
+    for (int bz = brickMin.z; bz <= brickMax.z; bz++) {
+      for (int bx = brickMin.x; bx <= brickMax.x; bx++) {
+        int brick = brickIndex(bx, by, bz);
+        if (!isBrickOccupied(brick)) continue;
+
+        glm::ivec3 brickOrigin = glm::ivec3{bx, by, bz} * BRICK_EDGE;
+        glm::ivec3 lo = glm::max(min - brickOrigin, glm::ivec3{0});
+        glm::ivec3 hi = glm::min(max - brickOrigin, glm::ivec3{BRICK_EDGE});
+        if (!isBrickRegionEmpty(brick, lo, hi)) return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Brickmap::isBrickRegionEmpty(int brick, glm::ivec3 lo, glm::ivec3 hi) const {
+  // whole brick covered and occupied, no need to look at the bits
+  if (lo == glm::ivec3{0} && hi == glm::ivec3{BRICK_EDGE}) return false;
+
+  uint64_t rowMask = ((1ull << (hi.x - lo.x)) - 1ull) << lo.x;
+  uint64_t layerMask = 0;
+  for (int z = lo.z; z < hi.z; z++) {
+    layerMask |= rowMask << (z * BRICK_EDGE);
+  }
+  for (int y = lo.y; y < hi.y; y++) {
+    if (bricks[brick][y] & layerMask) return false;
+  }
+  return true;
+}
+
+bool Brickmap::overlapsAABB(glm::vec3 min, glm::vec3 max) const {
+  glm::ivec3 lo{
+      static_cast<int>(std::floor(min.x)),
+      static_cast<int>(std::floor(min.y)),
+      static_cast<int>(std::floor(min.z))};
+  glm::ivec3 hi{
+      static_cast<int>(std::ceil(max.x)),
+      static_cast<int>(std::ceil(max.y)),
+      static_cast<int>(std::ceil(max.z))};
+  return !isRegionEmpty(lo, hi);
+}
+
+bool Brickmap::raycast(
+    glm::vec3 origin, glm::vec3 direction, float maxDistance, RaycastHit &hit) const {
+  if (occupiedMask == 0) return false;
+
+  float length = glm::length(direction);
+  if (length <= 0.f) return false;
+  direction /= length;
+
+  // clip the ray against the chunk bounds
+  float tEnter = 0.f;
+  float tExit = maxDistance;
+  glm::ivec3 enterNormal{0};
+  for (int a = 0; a < 3; a++) {
+    if (direction[a] == 0.f) {
+      if (origin[a] < 0.f || origin[a] > static_cast<float>(EDGE)) return false;
+      continue;
+    }
+    float t0 = (0.f - origin[a]) / direction[a];
+    float t1 = (static_cast<float>(EDGE) - origin[a]) / direction[a];
+    if (t0 > t1) std::swap(t0, t1);
+    if (t0 > tEnter) {
+      tEnter = t0;
+      enterNormal = glm::ivec3{0};
+      enterNormal[a] = direction[a] > 0.f ? -1 : 1;
+    }
+    tExit = std::min(tExit, t1);
+  }
+  if (tEnter > tExit) return false;
+
+  return traverseGrid(
+      origin,
+      direction,
+      static_cast<float>(BRICK_EDGE),
+      glm::ivec3{0},
+      glm::ivec3{BRICKS_PER_AXIS - 1},
+      tEnter,
+      tExit,
+      enterNormal,
+      [&](glm::ivec3 cell, float t, glm::ivec3 normal) {
+        int brick = brickIndex(cell.x, cell.y, cell.z);
+        if (!isBrickOccupied(brick)) return false;
+        return raycastBrick(brick, origin, direction, t, tExit, normal, hit);
+      });
+}
+
+bool Brickmap::raycastBrick(
+    int brick,
+    glm::vec3 origin,
+    glm::vec3 direction,
+    float tEnter,
+    float tExit,
+    glm::ivec3 enterNormal,
+    RaycastHit &hit) const {
+  int bx = brick % BRICKS_PER_AXIS;
+  int bz = (brick / BRICKS_PER_AXIS) % BRICKS_PER_AXIS;
+  int by = brick / (BRICKS_PER_AXIS * BRICKS_PER_AXIS);
+  glm::ivec3 lo = glm::ivec3{bx, by, bz} * BRICK_EDGE;
+  glm::ivec3 hi = lo + glm::ivec3{BRICK_EDGE - 1};
+
+  return traverseGrid(
+      origin,
+      direction,
+      1.f,
+      lo,
+      hi,
+      tEnter,
+      tExit,
+      enterNormal,
+      [&](glm::ivec3 cell, float t, glm::ivec3 normal) {
+        if (!isSolid(cell.x, cell.y, cell.z)) return false;
+        hit.voxel = cell;
+        hit.normal = normal;
+        hit.distance = t;
+        return true;
+      });
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "defines.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace zx {
+
+// Two level occupancy structure over a 32^3 chunk: a 4^3 grid of 8^3 bricks.
+// Each brick stores one bit per voxel (one 64 bit word per brick layer) and the
+// chunk keeps a 64 bit mask of occupied bricks and one of completely full bricks,
+// so empty space is skipped a whole brick at a time.
+class Brickmap {
+ public:
+  static constexpr int EDGE = 32;
+  static constexpr int BRICK_EDGE = 8;
+  static constexpr int BRICKS_PER_AXIS = EDGE / BRICK_EDGE;
+  static constexpr int BRICK_COUNT = BRICKS_PER_AXIS * BRICKS_PER_AXIS * BRICKS_PER_AXIS;
+  static constexpr int BRICK_VOLUME = BRICK_EDGE * BRICK_EDGE * BRICK_EDGE;
+
+  struct RaycastHit {
+    glm::ivec3 voxel{};
+    glm::ivec3 normal{};
+    float distance = 0.f;
+  };
+
+  static int brickIndex(int bx, int by, int bz) {
+    return (by * BRICKS_PER_AXIS + bz) * BRICKS_PER_AXIS + bx;
+  }
+
+  void clear();
+  void set(int x, int y, int z, bool solid);
+  // inline and branchless: empty bricks are all zero bits so no occupancy test is needed, and
+  // coordinates are never negative so unsigned math turns the divisions into shifts
+  bool isSolid(int x, int y, int z) const {
+    unsigned ux = x, uy = y, uz = z;
+    unsigned brick = (uy / BRICK_EDGE * BRICKS_PER_AXIS + uz / BRICK_EDGE) * BRICKS_PER_AXIS + ux / BRICK_EDGE;
+    unsigned bit = (uz % BRICK_EDGE) * BRICK_EDGE + ux % BRICK_EDGE;
+    return (bricks[brick][uy % BRICK_EDGE] >> bit) & 1ull;
+  }
+
+  bool isBrickOccupied(int brick) const { return (occupiedMask >> brick) & 1ull; }
+  bool isBrickFull(int brick) const { return (fullMask >> brick) & 1ull; }
+  // full brick whose six neighbours inside the chunk are full as well, none of its voxels can be seen
+  bool isBrickBuried(int bx, int by, int bz) const;
+  bool isEmpty() const { return occupiedMask == 0; }
+
+  // [min, max) in chunk local voxel coordinates, clamped to the chunk
+  bool isRegionEmpty(glm::ivec3 min, glm::ivec3 max) const;
+  // true if any solid voxel overlaps the box given in chunk local space
+  bool overlapsAABB(glm::vec3 min, glm::vec3 max) const;
+  // origin and direction in chunk local space, direction does not need to be normalized
+  bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RaycastHit &hit) const;
+
+ private:
+  bool isBrickRegionEmpty(int brick, glm::ivec3 min, glm::ivec3 max) const;
+  bool raycastBrick(
+      int brick,
+      glm::vec3 origin,
+      glm::vec3 direction,
+      float tEnter,
+      float tExit,
+      glm::ivec3 enterNormal,
+      RaycastHit &hit) const;
+
+  // bricks[b][y] holds bit (z * 8 + x) of brick layer y
+  std::array<std::array<uint64_t, BRICK_EDGE>, BRICK_COUNT> bricks{};
+  std::array<uint16_t, BRICK_COUNT> solidCounts{};
+  uint64_t occupiedMask = 0;
+  uint64_t fullMask = 0;
+};
+}
@@ -21,7 +21,7 @@ template <>
 struct hash<Vertex> {
   size_t operator()(Vertex const &vertex) const {
     size_t seed = 0;
-    zx::hashCombine(seed, vertex.position.x, vertex.position.y, vertex.position.z, vertex.color.x, vertex.color.y, vertex.color.z, vertex.normal.x, vertex.normal.y, vertex.normal.z);
+    zx::hashCombine(seed, vertex.position.x, vertex.position.y, vertex.position.z, vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.blockId);
     return seed;
   }
 };
@@ -32,87 +32,103 @@ namespace zx {
 
   Chunk::~Chunk() {}
   
-  void Chunk::createVertexBuffers() {
-    vertexCount = static_cast<uint32_t>(vertices.size());
-    info(std::to_string(vertexCount), 1);
-    assert(vertexCount >= 3 && "Vertex count must be at least 3!");
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+  void Chunk::uploadMesh(Mesh &target) {
+    target.vertexCount = static_cast<uint32_t>(vertices.size());
+    target.indexCount = static_cast<uint32_t>(indices.size());
+    target.hasIndexBuffer = target.indexCount > 0;
+    if (target.vertexCount == 0) {
+      // every brick was skipped, nothing to upload
+      target.vertexBuffer.reset();
+      target.indexBuffer.reset();
+      return;
+    }
+    assert(target.vertexCount >= 3 && "Vertex count must be at least 3!");
     uint32_t vertexSize = sizeof(vertices[0]);
 
-    ZxBuffer stagingBuffer{
+    ZxBuffer vertexStaging{
         zxDevice,
         vertexSize,
-        vertexCount,
+        target.vertexCount,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
     };
+    vertexStaging.map();
+    vertexStaging.writeToBuffer((void *)vertices.data());
 
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void *)vertices.data());
-
-    vertexBuffer = std::make_unique<ZxBuffer>(
+    target.vertexBuffer = std::make_unique<ZxBuffer>(
         zxDevice,
         vertexSize,
-        vertexCount,
+        target.vertexCount,
         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    zxDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
-  }
-
-  void Chunk::createIndexBuffers() {
-    indexCount = static_cast<uint32_t>(indices.size());
-    hasIndexBuffer = indexCount > 0;
+    // both copies go in one command buffer, a mesh costs a single queue wait
+    VkCommandBuffer commandBuffer = zxDevice.beginSingleTimeCommands();
+    VkBufferCopy vertexCopy{0, 0, vertexStaging.getBufferSize()};
+    vkCmdCopyBuffer(commandBuffer, vertexStaging.getBuffer(), target.vertexBuffer->getBuffer(), 1, &vertexCopy);
+
+    std::unique_ptr<ZxBuffer> indexStaging;
+    if (target.hasIndexBuffer) {
+      target.indexType = ZxModel::indexTypeFor(target.vertexCount);
+      bool shortIndices = target.indexType == VK_INDEX_TYPE_UINT16;
+      uint32_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+      indexStaging = std::make_unique<ZxBuffer>(
+          zxDevice,
+          indexSize,
+          target.indexCount,
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+      indexStaging->map();
+      if (shortIndices) {
+        // narrowed while writing the staging buffer, halves what the GPU reads per index
+        auto *shortData = static_cast<uint16_t *>(indexStaging->getMappedMemory());
+        for (uint32_t i = 0; i < target.indexCount; i++) {
+          shortData[i] = static_cast<uint16_t>(indices[i]);
+        }
+      } else {
+        indexStaging->writeToBuffer((void *)indices.data());
+      }
 
-    if (!hasIndexBuffer) {
-      return;
+      target.indexBuffer = std::make_unique<ZxBuffer>(
+          zxDevice,
+          indexSize,
+          target.indexCount,
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      VkBufferCopy indexCopy{0, 0, indexStaging->getBufferSize()};
+      vkCmdCopyBuffer(commandBuffer, indexStaging->getBuffer(), target.indexBuffer->getBuffer(), 1, &indexCopy);
+    } else {
+      target.indexBuffer.reset();
     }
-
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-    uint32_t indexSize = sizeof(indices[0]);
-
-    ZxBuffer stagingBuffer{
-        zxDevice,
-        indexSize,
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void *)indices.data());
-
-    indexBuffer = std::make_unique<ZxBuffer>(
-        zxDevice,
-        indexSize,
-        indexCount,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    zxDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+    zxDevice.endSingleTimeCommands(commandBuffer);
   }
 
-
-
-  void Chunk::draw(VkCommandBuffer commandBuffer) {
-    if (hasIndexBuffer) {
-      vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+  void Chunk::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance) {
+    if (mesh.vertexCount == 0) {
+      return;
+    }
+    if (mesh.hasIndexBuffer) {
+      vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, firstInstance);
     } else {
-      vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+      vkCmdDraw(commandBuffer, mesh.vertexCount, 1, 0, firstInstance);
     }
   }
 
   void Chunk::bind(VkCommandBuffer commandBuffer) {
-    VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+    if (mesh.vertexCount == 0) {
+      return;
+    }
+    VkBuffer buffers[] = {mesh.vertexBuffer->getBuffer()};
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
-    if (hasIndexBuffer) {
-      vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    if (mesh.hasIndexBuffer) {
+      vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer->getBuffer(), 0, mesh.indexType);
     }
   }
 
-std::vector<VkVertexInputBindingDescription> Chunk::Vertex::getBindingDescriptions() {
+std::vector<VkVertexInputBindingDescription> Chunk::getVertexBindingDescriptions() {
   std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
   bindingDescriptions[0].binding = 0;
   bindingDescriptions[0].stride = sizeof(Vertex);
@@ -120,104 +136,109 @@ std::vector<VkVertexInputBindingDescription> Chunk::Vertex::getBindingDescriptio
   return bindingDescriptions;
 }
 
-std::vector<VkVertexInputAttributeDescription> Chunk::Vertex::getAttributeDescriptions() {
+std::vector<VkVertexInputAttributeDescription> Chunk::getVertexAttributeDescriptions() {
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
   attributeDescriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
-  attributeDescriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
+  attributeDescriptions.push_back({1, 0, VK_FORMAT_R32_UINT, offsetof(Vertex, blockId)});
   attributeDescriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)});
 
   return attributeDescriptions;
 }
 
-  void Chunk::intializeChunk(){
-    voxels.reserve(32*32*32);
+  float Chunk::terrainHeight(float x, float z){
+    int n = int(((SimplexNoise::noise(x, z)+1.f)/2.f)*32.f);
+    return n/2.f;
+  }
+
+  void Chunk::intializeChunk(glm::ivec3 chunkOrigin){
+    origin = chunkOrigin;
+    voxels.clear();
+    voxels.reserve(SIZE*SIZE*SIZE);
 
-    float frequency = 32.f;
-    float amplitude = 16.f;
-    float lacunarity = 2.3f;
-    SimplexNoise noise = SimplexNoise(frequency, amplitude, lacunarity, 1.f/lacunarity);
+    // the heightfield only depends on the column, sample it once per column
+    std::array<float, SIZE*SIZE> heights;
+    for(int z = 0; z < SIZE; z++){
+      for(int x = 0; x < SIZE; x++){
+        heights[z*SIZE + x] = terrainHeight(static_cast<float>(origin.x + x), static_cast<float>(origin.z + z));
+      }
+    }
 
-    for(int y = 0; y < 32; y++){
-      for(int z = 0; z < 32; z++){
-        for(int x = 0; x < 32; x++){
-          int n = int(((noise.noise(x, z)+1.f)/2.f)*32.f);
-          info(std::to_string(n), 1)
+    for(int y = 0; y < SIZE; y++){
+      for(int z = 0; z < SIZE; z++){
+        for(int x = 0; x < SIZE; x++){
           Voxel voxel;
           voxel.position = { x, y, z };
-          //voxel.type = y >= n ? stone : air;
-          voxel.type = y < (glm::sin(x)+1.f)/2.f*32.f ? stone : air;
-          voxel.type = y < n/2.f ? stone : air;
+          float height = heights[z*SIZE + x];
+          // the top voxel of every column is grass
+          voxel.type = origin.y + y < height ? (origin.y + y + 1 < height ? stone : grass) : air;
 
           voxels.push_back(voxel);
         }
       }
     }
-    //info(std::to_string(i), 1);
+    rebuildBrickmap();
   }
 
-  void Chunk::createMesh(){
-    vertices.clear();
-    indices.clear();
+  std::vector<uint8_t> Chunk::getVoxelTypes() const{
+    std::vector<uint8_t> types(voxels.size());
+    for(size_t i = 0; i < voxels.size(); i++){
+      types[i] = static_cast<uint8_t>(voxels[i].type);
+    }
+    return types;
+  }
 
-    static const float voxel_vertices[] = {
-    0, 0, 0,
-    1, 0, 0,
-    1, 1, 0,
-    0, 1, 0,
+  void Chunk::loadVoxelTypes(glm::ivec3 chunkOrigin, const std::vector<uint8_t> &types){
+    assert(types.size() == SIZE*SIZE*SIZE && "Voxel type array does not match the chunk size!");
+    origin = chunkOrigin;
+    voxels.clear();
+    voxels.reserve(SIZE*SIZE*SIZE);
 
-    0, 0, 1,
-    1, 0, 1,
-    1, 1, 1,
-    0, 1, 1
-    };
+    for(int y = 0; y < SIZE; y++){
+      for(int z = 0; z < SIZE; z++){
+        for(int x = 0; x < SIZE; x++){
+          Voxel voxel;
+          voxel.position = { x, y, z };
+          voxel.type = static_cast<VoxelType>(types[voxelIndex(x, y, z)]);
 
-    static int sz_vv = sizeof(voxel_vertices)/sizeof(voxel_vertices[0]);
-
-    static const uint32_t voxel_indices[] = {
-    1, 0, 3, 1, 3, 2, // north (-z)
-    4, 5, 6, 4, 6, 7, // south (+z)
-    5, 1, 2, 5, 2, 6, // east (+x)
-    0, 4, 7, 0, 7, 3, // west (-x)
-    2, 3, 7, 2, 7, 6, // top (+y)
-    5, 4, 0, 5, 0, 1, // bottom (-y)
-    };  
-
-    static const glm::vec3 voxel_normals[] = { {0.f, 0.f, -1.f}, {0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f} };
-    static int sz_vn = sizeof(voxel_normals)/sizeof(voxel_normals[0]);
-    
-    static int sz_vi = sizeof(voxel_indices)/sizeof(voxel_indices[0]);
-
-    int j = 0;
-    for(int y = 0; y < 32; y++){
-      for(int z = 0; z < 32; z++){
-        for(int x = 0; x < 32; x++){
-            for(int i = 0, k = 0; i < sz_vv; i+=3, i%6==0 ? k++ : k=k){
-              Vertex vertex;
-
-              float xx = voxel_vertices[i]+x;
-              float yy = voxel_vertices[i+1]+y;
-              float zz = voxel_vertices[i+2]+z;
-              vertex.position = { xx, yy, zz };
-              
-              glm::vec3 gray = { 0.4f, .4f, 0.4f };
-              glm::vec3 red = {0.8f, 0.2f, 0.25f};
-              vertex.color = voxels[j].type != air ? gray : red;
-
-              glm::vec3 vn = voxel_normals[k];
-              vertex.normal = vn;
-              
-              vertices.push_back(vertex);
-            }
-            for(int i = 0; i < sz_vi; i++){
-              indices.push_back(voxel_indices[i]+8*j);
-            }
-            j++;
-        } // x
-      } // y
-    } // z
-    
-    createVertexBuffers();
-    createIndexBuffers();
+          voxels.push_back(voxel);
+        }
+      }
+    }
+    rebuildBrickmap();
+    modified = false;
   }
-}
\ No newline at end of file
+
+  void Chunk::rebuildBrickmap(){
+    brickmap.clear();
+    for(int y = 0; y < SIZE; y++){
+      for(int z = 0; z < SIZE; z++){
+        for(int x = 0; x < SIZE; x++){
+          brickmap.set(x, y, z, voxels[voxelIndex(x, y, z)].type != air);
+        }
+      }
+    }
+  }
+
+  void Chunk::setVoxel(int x, int y, int z, VoxelType type){
+    assert(x >= 0 && y >= 0 && z >= 0 && x < SIZE && y < SIZE && z < SIZE && "Voxel out of chunk bounds!");
+    Voxel &voxel = voxels[voxelIndex(x, y, z)];
+    if(voxel.type == type) return;
+
+    voxel.type = type;
+    brickmap.set(x, y, z, type != air);
+    meshDirty = true;
+    modified = true;
+  }
+
+  Chunk::Mesh Chunk::createMesh(int lod){
+    meshStats = ChunkMesher::build(mesher, lod, origin, brickmap, voxels.data(), vertices, indices);
+
+    Mesh replaced = std::move(mesh);
+    mesh = Mesh{};
+    uploadMesh(mesh);
+    meshLod = lod;
+    meshDirty = false;
+    return replaced;
+  }
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "defines.hpp"
+#include "brickmap.hpp"
+#include "chunk_mesher.hpp"
 #include "zx_buffer.hpp"
 #include "zx_device.hpp"
 
@@ -8,62 +10,80 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 namespace zx {
-  enum VoxelType{
-    air = 0,
-    stone = 1,
-    grass = 2
-  };
-  
-  struct Voxel {
-    glm::vec3 position{};
-    VoxelType type{};
-
-    bool operator==(const Voxel &other) const {
-      return type == other.type;
-    }
-  };
-  
   class Chunk {
     public:
-      struct Vertex {
-        glm::vec3 position{};
-        glm::vec3 color{};
-        glm::vec3 normal{};
+      static constexpr int SIZE = ChunkMesher::SIZE;
+      static constexpr int LOD_COUNT = ChunkMesher::LOD_COUNT;
+
+      using Mesher = ChunkMesher::Mesher;
+      using Vertex = ChunkMesher::Vertex;
+
+      static std::vector<VkVertexInputBindingDescription> getVertexBindingDescriptions();
+      static std::vector<VkVertexInputAttributeDescription> getVertexAttributeDescriptions();
 
-        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+      struct Mesh {
+        std::unique_ptr<ZxBuffer> vertexBuffer;
+        uint32_t vertexCount = 0;
 
-        bool operator==(const Vertex &other) const {
-          return position == other.position && color == other.color && normal == other.normal;
-        }
+        bool hasIndexBuffer = false;
+        std::unique_ptr<ZxBuffer> indexBuffer;
+        uint32_t indexCount = 0;
+        // 16 bit whenever every vertex can be addressed with it
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
       };
 
       Chunk(ZxDevice &device);
       ~Chunk();
 
+      // draw the resident mesh, whatever LOD it was built at
       void bind(VkCommandBuffer commandBuffer);
-      void draw(VkCommandBuffer commandBuffer);
+      // firstInstance selects the object buffer entry read by the vertex shader
+      void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0);
 
-      void createVertexBuffers();
-      void createIndexBuffers();
-      void intializeChunk();
-      void createMesh();
+      // uploads vertices and indices into new buffers with one submit, the index type depends on
+      // the vertex count
+      void uploadMesh(Mesh &target);
+      // fills the chunk from the terrain heightfield, origin is the world voxel coordinate of its corner
+      void intializeChunk(glm::ivec3 chunkOrigin);
+      // terrain surface height of the world column (x, z), shared by chunks and the far terrain clipmap
+      static float terrainHeight(float x, float z);
+      // builds the mesh of one LOD with the selected mesher and uploads it. Only one LOD is
+      // resident at a time: returns the mesh it replaced, the frames in flight may still draw it
+      Mesh createMesh(int lod);
 
+      static int voxelIndex(int x, int y, int z) { return (y * SIZE + z) * SIZE + x; }
+      VoxelType getVoxel(int x, int y, int z) const { return voxels[voxelIndex(x, y, z)].type; }
+      // updates the brickmap incrementally, the mesh is rebuilt by the next createMesh
+      void setVoxel(int x, int y, int z, VoxelType type);
+      void rebuildBrickmap();
+
+      // voxel types in voxelIndex order, the form chunks are saved in
+      std::vector<uint8_t> getVoxelTypes() const;
+      void loadVoxelTypes(glm::ivec3 chunkOrigin, const std::vector<uint8_t> &types);
+
+      glm::ivec3 origin{};
       std::vector<Voxel> voxels;
+      Brickmap brickmap{};
+      // voxels changed since the resident mesh was built
+      bool meshDirty = false;
+      // edited since it was generated or loaded, has to be saved
+      bool modified = false;
+      Mesher mesher = Mesher::blocky;
 
       ZxDevice &zxDevice;
 
-      std::unique_ptr<ZxBuffer> vertexBuffer;
-      uint32_t vertexCount;
-
-      bool hasIndexBuffer = false;
-      std::unique_ptr<ZxBuffer> indexBuffer;
-      uint32_t indexCount;
+      Mesh mesh{};
+      // LOD of mesh, -1 until the first createMesh
+      int meshLod = -1;
+      // vertex cache optimization of the last createMesh, zero when the mesher skips it
+      MeshOptimizer::Stats meshStats{};
 
+      // scratch of createMesh, kept to avoid reallocating on every rebuild
       std::vector<Vertex> vertices{};
       std::vector<uint32_t> indices{};
   };
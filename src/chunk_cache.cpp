@@ -0,0 +1,44 @@
+#include "chunk_cache.hpp"
+
+#include "chunk_codec.hpp"
+
+namespace zx {
+
+void ChunkCache::store(glm::ivec3 coord, const std::vector<uint8_t> &types) {
+  auto it = index.find(coord);
+  if (it != index.end()) erase(it->second);
+
+  entries.push_front(Entry{coord, ChunkCodec::encode(types.data(), types.size())});
+  index[coord] = entries.begin();
+  bytes += entries.front().payload.size();
+  evict();
+}
+
+bool ChunkCache::load(glm::ivec3 coord, std::vector<uint8_t> &types) {
+  auto it = index.find(coord);
+  if (it == index.end()) return false;
+
+  bool decoded = ChunkCodec::decode(it->second->payload.data(), it->second->payload.size(), types);
+  // the chunk goes back to being loaded, it is stored again when it is unloaded
+  erase(it->second);
+  return decoded;
+}
+
+void ChunkCache::setBudget(size_t budget) {
+  byteBudget = budget;
+  evict();
+}
+
+void ChunkCache::erase(std::list<Entry>::iterator it) {
+  bytes -= it->payload.size();
+  index.erase(it->coord);
+  entries.erase(it);
+}
+
+void ChunkCache::evict() {
+  while (bytes > byteBudget && !entries.empty()) {
+    erase(std::prev(entries.end()));
+  }
+}
+
+}
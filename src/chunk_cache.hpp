@@ -0,0 +1,60 @@
+#pragma once
+
+#include "defines.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace zx {
+
+struct ChunkCoordHash {
+  size_t operator()(const glm::ivec3 &coord) const {
+    // large primes, spreads neighbouring chunk coordinates over the buckets
+    return static_cast<size_t>(coord.x) * 73856093u ^ static_cast<size_t>(coord.y) * 19349663u ^
+           static_cast<size_t>(coord.z) * 83492791u;
+  }
+};
+
+// Compressed voxels of chunks that were unloaded, so coming back to them costs a decode
+// instead of terrain generation or a disk read. Least recently stored chunks are dropped
+// once the payloads go over the byte budget.
+class ChunkCache {
+ public:
+  explicit ChunkCache(size_t byteBudget) : byteBudget{byteBudget} {}
+
+  ChunkCache(const ChunkCache &) = delete;
+  ChunkCache &operator=(const ChunkCache &) = delete;
+
+  // types in Chunk::voxelIndex order, replaces any older copy of the chunk
+  void store(glm::ivec3 coord, const std::vector<uint8_t> &types);
+  // decodes and removes the chunk, false if it is not cached
+  bool load(glm::ivec3 coord, std::vector<uint8_t> &types);
+
+  void setBudget(size_t budget);
+  size_t getBudget() const { return byteBudget; }
+  size_t getBytes() const { return bytes; }
+  size_t getCount() const { return entries.size(); }
+
+ private:
+  struct Entry {
+    glm::ivec3 coord;
+    std::vector<uint8_t> payload;
+  };
+
+  void erase(std::list<Entry>::iterator it);
+  void evict();
+
+  size_t byteBudget;
+  size_t bytes = 0;
+  // most recently stored at the front
+  std::list<Entry> entries;
+  std::unordered_map<glm::ivec3, std::list<Entry>::iterator, ChunkCoordHash> index;
+};
+}
@@ -0,0 +1,462 @@
+#include "chunk_codec.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace zx {
+
+namespace {
+constexpr size_t HEADER_SIZE = 5;
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 0xffff;
+constexpr int HASH_BITS = 12;
+
+// set on the type of the last run of a column, that run always reaches the top and has no length
+constexpr uint8_t LAST_RUN = 0x80;
+// run lengths are below EDGE, so never wider than this
+constexpr unsigned MAX_LENGTH_BITS = 5;
+// columns payloads bigger than this fraction of the chunk get rleLz tried as well
+constexpr size_t RLE_LZ_THRESHOLD = 16;
+
+uint32_t read32(const uint8_t *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t load64(const uint8_t *p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+void store64(uint8_t *p, uint64_t value) { std::memcpy(p, &value, sizeof(value)); }
+
+void swapBits(uint64_t &a, uint64_t &b, int shift, uint64_t mask) {
+  uint64_t t = ((a >> shift) ^ b) & mask;
+  a ^= t << shift;
+  b ^= t;
+}
+
+// byte i of word j swaps with byte j of word i (little endian byte order): 4x4 blocks first,
+// then 2x2 blocks, then single bytes. Spelled out so it stays in registers at -O2
+void transpose8x8(uint64_t &r0, uint64_t &r1, uint64_t &r2, uint64_t &r3,
+                  uint64_t &r4, uint64_t &r5, uint64_t &r6, uint64_t &r7) {
+  swapBits(r0, r4, 32, 0x00000000ffffffffull);
+  swapBits(r1, r5, 32, 0x00000000ffffffffull);
+  swapBits(r2, r6, 32, 0x00000000ffffffffull);
+  swapBits(r3, r7, 32, 0x00000000ffffffffull);
+  swapBits(r0, r2, 16, 0x0000ffff0000ffffull);
+  swapBits(r1, r3, 16, 0x0000ffff0000ffffull);
+  swapBits(r4, r6, 16, 0x0000ffff0000ffffull);
+  swapBits(r5, r7, 16, 0x0000ffff0000ffffull);
+  swapBits(r0, r1, 8, 0x00ff00ff00ff00ffull);
+  swapBits(r2, r3, 8, 0x00ff00ff00ff00ffull);
+  swapBits(r4, r5, 8, 0x00ff00ff00ff00ffull);
+  swapBits(r6, r7, 8, 0x00ff00ff00ff00ffull);
+}
+
+// src is rows x columns bytes, dst becomes columns x rows. Both have to be multiples of 8,
+// the matrix is walked in 8x8 byte blocks each transposed in eight words
+void transpose(const uint8_t *src, uint8_t *dst, size_t rows, size_t columns) {
+  for (size_t row = 0; row < rows; row += 8) {
+    for (size_t column = 0; column < columns; column += 8) {
+      const uint8_t *in = src + row * columns + column;
+      uint64_t r0 = load64(in), r1 = load64(in + columns), r2 = load64(in + 2 * columns),
+               r3 = load64(in + 3 * columns), r4 = load64(in + 4 * columns),
+               r5 = load64(in + 5 * columns), r6 = load64(in + 6 * columns),
+               r7 = load64(in + 7 * columns);
+      transpose8x8(r0, r1, r2, r3, r4, r5, r6, r7);
+      uint8_t *out = dst + column * rows + row;
+      store64(out, r0);
+      store64(out + rows, r1);
+      store64(out + 2 * rows, r2);
+      store64(out + 3 * rows, r3);
+      store64(out + 4 * rows, r4);
+      store64(out + 5 * rows, r5);
+      store64(out + 6 * rows, r6);
+      store64(out + 7 * rows, r7);
+    }
+  }
+}
+
+// writes EDGE bytes of value, whatever the run length, to keep the loop free of branches
+void fillColumn(uint8_t *cell, uint8_t value) {
+  uint64_t word = value * 0x0101010101010101ull;
+  for (size_t i = 0; i < ChunkCodec::EDGE; i += sizeof(word)) std::memcpy(cell + i, &word, sizeof(word));
+}
+
+uint32_t hash4(uint32_t value) { return (value * 2654435761u) >> (32 - HASH_BITS); }
+
+// lengths above 15 spill into 255 valued bytes followed by the remainder
+void writeLength(std::vector<uint8_t> &out, size_t length) {
+  while (length >= 255) {
+    out.push_back(255);
+    length -= 255;
+  }
+  out.push_back(static_cast<uint8_t>(length));
+}
+
+bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length) {
+  uint8_t byte;
+  do {
+    if (in == end) return false;
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+void writeVarint(std::vector<uint8_t> &out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t *&in, const uint8_t *end, uint32_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (in == end) return false;
+    uint8_t byte = *in++;
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+}  // namespace
+
+std::vector<uint8_t> ChunkCodec::encode(const uint8_t *types, size_t count) {
+  assert(count == CHUNK_VOLUME && "Chunk codec only encodes whole chunks!");
+
+  auto startPayload = [count](Method method) {
+    std::vector<uint8_t> out(HEADER_SIZE);
+    out[0] = method;
+    uint32_t rawSize = static_cast<uint32_t>(count);
+    std::memcpy(out.data() + 1, &rawSize, sizeof(rawSize));
+    return out;
+  };
+
+  std::vector<uint8_t> out = startPayload(columns);
+  bool packed = encodeColumns(types, out);
+  if (!packed || out.size() > count / RLE_LZ_THRESHOLD) {
+    std::vector<uint8_t> candidate = startPayload(rleLz);
+    encodeRleLz(types, candidate);
+    if (!packed || candidate.size() < out.size()) out = std::move(candidate);
+  }
+
+  // the types themselves are the baseline every method has to beat
+  if (out.size() >= HEADER_SIZE + count) {
+    out = startPayload(raw);
+    out.insert(out.end(), types, types + count);
+  }
+
+#ifdef ZX_CHECK_CHUNK_CODEC
+  // decodes every chunk a second time, only for hunting codec bugs
+  std::vector<uint8_t> check;
+  assert(decode(out.data(), out.size(), check) && "Chunk payload failed to decode!");
+  assert(check.size() == count && std::memcmp(check.data(), types, count) == 0 &&
+         "Chunk payload does not round trip!");
+#endif
+  return out;
+}
+
+bool ChunkCodec::decode(const uint8_t *payload, size_t size, std::vector<uint8_t> &types) {
+  if (size < HEADER_SIZE) return false;
+
+  // the size comes from disk, never allocate for anything but a chunk
+  uint32_t rawSize;
+  std::memcpy(&rawSize, payload + 1, sizeof(rawSize));
+  if (rawSize != CHUNK_VOLUME) return false;
+  types.resize(CHUNK_VOLUME);
+
+  const uint8_t *in = payload + HEADER_SIZE;
+  size_t remaining = size - HEADER_SIZE;
+  switch (payload[0]) {
+    case rle:
+      return decodeRuns(in, remaining, types.data(), CHUNK_VOLUME);
+    case rleLz:
+      return decodeRleLz(in, remaining, types.data());
+    case columns:
+      return decodeColumns(in, remaining, types.data());
+    case raw:
+      if (remaining != CHUNK_VOLUME) return false;
+      std::memcpy(types.data(), in, CHUNK_VOLUME);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// [varint run count][length bits][bit packed lengths][LZ compressed run types]. Columns are
+// walked in layer order, every run but the last of a column stores its length minus one
+bool ChunkCodec::encodeColumns(const uint8_t *types, std::vector<uint8_t> &out) {
+  std::vector<uint8_t> columnMajor(CHUNK_VOLUME);
+  transpose(types, columnMajor.data(), EDGE, LAYER_SIZE);
+
+  std::vector<uint8_t> runTypes;
+  std::vector<uint8_t> runLengths;
+  runTypes.reserve(LAYER_SIZE * 3);
+  runLengths.reserve(LAYER_SIZE * 2);
+
+  uint8_t maxLength = 0;
+  for (size_t column = 0; column < LAYER_SIZE; column++) {
+    const uint8_t *cell = columnMajor.data() + column * EDGE;
+    size_t y = 0;
+    while (true) {
+      uint8_t type = cell[y];
+      // the tag bit is taken, such chunks go to rleLz
+      if (type & LAST_RUN) return false;
+
+      size_t top = y + 1;
+      while (top < EDGE && cell[top] == type) top++;
+      if (top == EDGE) {
+        runTypes.push_back(type | LAST_RUN);
+        break;
+      }
+      runTypes.push_back(type);
+      runLengths.push_back(static_cast<uint8_t>(top - y - 1));
+      maxLength = std::max(maxLength, runLengths.back());
+      y = top;
+    }
+  }
+
+  unsigned bits = 0;
+  while ((1u << bits) <= maxLength) bits++;
+
+  writeVarint(out, static_cast<uint32_t>(runTypes.size()));
+  out.push_back(static_cast<uint8_t>(bits));
+  uint32_t buffer = 0;
+  unsigned buffered = 0;
+  for (uint8_t length : runLengths) {
+    buffer |= static_cast<uint32_t>(length) << buffered;
+    buffered += bits;
+    if (buffered >= 8) {
+      out.push_back(static_cast<uint8_t>(buffer));
+      buffer >>= 8;
+      buffered -= 8;
+    }
+  }
+  if (buffered > 0) out.push_back(static_cast<uint8_t>(buffer));
+
+  encodeLz(runTypes.data(), runTypes.size(), out);
+  return true;
+}
+
+bool ChunkCodec::decodeColumns(const uint8_t *in, size_t size, uint8_t *types) {
+  const uint8_t *end = in + size;
+  uint32_t runCount;
+  if (!readVarint(in, end, runCount) || runCount < LAYER_SIZE || runCount > CHUNK_VOLUME) return false;
+  if (in == end) return false;
+  unsigned bits = *in++;
+  if (bits > MAX_LENGTH_BITS) return false;
+
+  size_t lengthCount = runCount - LAYER_SIZE;
+  size_t packedSize = (lengthCount * bits + 7) / 8;
+  if (packedSize > static_cast<size_t>(end - in)) return false;
+
+  // unpacked up front so the fill loop below has no data dependent branches, with one
+  // spare entry the last run of the chunk reads without using it
+  uint8_t lengths[CHUNK_VOLUME - LAYER_SIZE + 1];
+  const uint32_t mask = (1u << bits) - 1u;
+  uint32_t buffer = 0;
+  unsigned buffered = 0;
+  for (size_t i = 0; i < lengthCount; i++) {
+    // bits is below 8, one byte always refills enough
+    if (buffered < bits) {
+      buffer |= static_cast<uint32_t>(*in++) << buffered;
+      buffered += 8;
+    }
+    lengths[i] = static_cast<uint8_t>(buffer & mask);
+    buffer >>= bits;
+    buffered -= bits;
+  }
+  lengths[lengthCount] = 0;
+
+  uint8_t runTypes[CHUNK_VOLUME];
+  if (!decodeLz(in, end - in, runTypes, runCount)) return false;
+
+  // columns are filled contiguously and transposed into layers afterwards, writing them
+  // straight into the layers is a store every LAYER_SIZE bytes. Every run writes a whole
+  // column worth of bytes from its bottom, the runs above and the next column overwrite
+  // what lies past its top, the slack takes what the last column spills
+  alignas(8) uint8_t columnMajor[CHUNK_VOLUME + EDGE];
+  size_t column = 0;
+  size_t y = 0;
+  size_t length = 0;
+  for (size_t run = 0; run < runCount; run++) {
+    if (column == LAYER_SIZE || length > lengthCount) return false;
+
+    uint8_t type = runTypes[run];
+    bool last = (type & LAST_RUN) != 0;
+    size_t top = last ? EDGE : y + lengths[length] + 1;
+    length += !last;
+    // only the last run of a column may reach the top
+    if (top > EDGE || (top == EDGE && !last)) return false;
+
+    fillColumn(columnMajor + column * EDGE + y, type & ~LAST_RUN);
+    y = last ? 0 : top;
+    column += last;
+  }
+  if (column != LAYER_SIZE || length != lengthCount) return false;
+
+  transpose(columnMajor, types, LAYER_SIZE, EDGE);
+  return true;
+}
+
+// [varint runs size][LZ compressed runs] of the layer delta
+void ChunkCodec::encodeRleLz(const uint8_t *types, std::vector<uint8_t> &out) {
+  std::vector<uint8_t> delta(CHUNK_VOLUME);
+  deltaLayers(types, CHUNK_VOLUME, delta.data());
+  std::vector<uint8_t> runs;
+  encodeRuns(delta.data(), CHUNK_VOLUME, runs);
+
+  writeVarint(out, static_cast<uint32_t>(runs.size()));
+  encodeLz(runs.data(), runs.size(), out);
+}
+
+bool ChunkCodec::decodeRleLz(const uint8_t *in, size_t size, uint8_t *types) {
+  const uint8_t *end = in + size;
+  uint32_t runsSize;
+  if (!readVarint(in, end, runsSize)) return false;
+  // a run costs at least two bytes and covers at least one voxel
+  if (runsSize > CHUNK_VOLUME * 2) return false;
+
+  std::vector<uint8_t> runs(runsSize);
+  if (!decodeLz(in, end - in, runs.data(), runsSize) ||
+      !decodeRuns(runs.data(), runsSize, types, CHUNK_VOLUME)) {
+    return false;
+  }
+  undeltaLayers(types, CHUNK_VOLUME);
+  return true;
+}
+
+// Most voxels match the one below them, so xor against the layer below turns everything
+// away from the surface into zeros and leaves long runs for the RLE stage.
+void ChunkCodec::deltaLayers(const uint8_t *types, size_t count, uint8_t *out) {
+  std::memcpy(out, types, LAYER_SIZE);
+  for (size_t i = LAYER_SIZE; i < count; i++) out[i] = types[i] ^ types[i - LAYER_SIZE];
+}
+
+void ChunkCodec::undeltaLayers(uint8_t *types, size_t count) {
+  // a word at a time, the layer below is always finished before the one above reads it
+  for (size_t i = LAYER_SIZE; i < count; i += sizeof(uint64_t)) {
+    uint64_t below;
+    uint64_t value;
+    std::memcpy(&below, types + i - LAYER_SIZE, sizeof(below));
+    std::memcpy(&value, types + i, sizeof(value));
+    value ^= below;
+    std::memcpy(types + i, &value, sizeof(value));
+  }
+}
+
+// (type, varint run length) pairs, terrain is mostly long runs of air and stone
+void ChunkCodec::encodeRuns(const uint8_t *types, size_t count, std::vector<uint8_t> &out) {
+  size_t i = 0;
+  while (i < count) {
+    uint8_t type = types[i];
+    size_t run = 1;
+    while (i + run < count && types[i + run] == type) run++;
+    out.push_back(type);
+    writeVarint(out, static_cast<uint32_t>(run));
+    i += run;
+  }
+}
+
+bool ChunkCodec::decodeRuns(const uint8_t *in, size_t size, uint8_t *types, size_t count) {
+  const uint8_t *end = in + size;
+  size_t written = 0;
+  while (in != end) {
+    uint8_t type = *in++;
+    uint32_t run;
+    if (!readVarint(in, end, run) || run > count - written) return false;
+    std::memset(types + written, type, run);
+    written += run;
+  }
+  return written == count;
+}
+
+// Sequences of [token][literal length][literals][offset][match length]. The token holds the
+// literal length and the match length minus MIN_MATCH in its high and low nibble, the last
+// sequence only has literals.
+void ChunkCodec::encodeLz(const uint8_t *in, size_t size, std::vector<uint8_t> &out) {
+  std::vector<int32_t> table(1u << HASH_BITS, -1);
+
+  auto emit = [&](size_t literalStart, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+    uint8_t token = static_cast<uint8_t>(
+        (std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+    out.push_back(token);
+    if (literalLength >= 15) writeLength(out, literalLength - 15);
+    out.insert(out.end(), in + literalStart, in + literalStart + literalLength);
+    if (matchLength == 0) return;
+
+    out.push_back(static_cast<uint8_t>(offset));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (matchCode >= 15) writeLength(out, matchCode - 15);
+  };
+
+  size_t anchor = 0;
+  size_t ip = 0;
+  while (ip + MIN_MATCH <= size) {
+    uint32_t sequence = read32(in + ip);
+    int32_t &slot = table[hash4(sequence)];
+    size_t ref = static_cast<size_t>(slot);
+    slot = static_cast<int32_t>(ip);
+
+    if (ref == static_cast<size_t>(-1) || ip - ref > MAX_OFFSET || read32(in + ref) != sequence) {
+      ip++;
+      continue;
+    }
+
+    size_t matchLength = MIN_MATCH;
+    while (ip + matchLength < size && in[ref + matchLength] == in[ip + matchLength]) matchLength++;
+
+    emit(anchor, ip - anchor, ip - ref, matchLength);
+    ip += matchLength;
+    anchor = ip;
+  }
+  emit(anchor, size - anchor, 0, 0);
+}
+
+bool ChunkCodec::decodeLz(const uint8_t *in, size_t size, uint8_t *out, size_t outSize) {
+  const uint8_t *end = in + size;
+  size_t op = 0;
+  while (in != end) {
+    uint8_t token = *in++;
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !readLength(in, end, literalLength)) return false;
+    if (literalLength > static_cast<size_t>(end - in) || literalLength > outSize - op) return false;
+    std::memcpy(out + op, in, literalLength);
+    in += literalLength;
+    op += literalLength;
+
+    if (in == end) break;
+
+    if (end - in < 2) return false;
+    size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(in, end, matchLength)) return false;
+    matchLength += MIN_MATCH;
+    if (offset == 0 || offset > op || matchLength > outSize - op) return false;
+
+    // an overlapping match repeats the last offset bytes. Every copy doubles the stretch of
+    // the pattern that lies behind dst, so copies grow instead of going a byte at a time
+    uint8_t *dst = out + op;
+    op += matchLength;
+    for (size_t distance = offset; matchLength > 0; distance *= 2) {
+      size_t n = std::min(matchLength, distance);
+      std::memcpy(dst, dst - distance, n);
+      dst += n;
+      matchLength -= n;
+    }
+  }
+  return op == outSize;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zx {
+
+// Compression of a chunk's voxel type array, in the y-major order Chunk stores it.
+// Every payload starts with the method it was written with and the decoded size, so
+// payloads stay readable when new methods are added.
+//
+// columns walks every (x, z) column bottom to top and splits it into runs. The run types
+// go through a byte oriented LZ77 stage (LZ4 style sequences, no entropy coding), the run
+// lengths are bit packed at the width of the longest one. A terrain column is stone, grass
+// and air, which costs two small lengths and a type pattern the LZ stage all but removes.
+//
+// rleLz xors every y layer with the one below it, run-length encodes the result as
+// (type, varint length) pairs and puts the runs through the same LZ stage. It is only
+// picked when it beats columns, chunks with many runs per column but flat layers.
+class ChunkCodec {
+ public:
+  static constexpr size_t EDGE = 32;
+  static constexpr size_t LAYER_SIZE = EDGE * EDGE;
+  // every payload decodes to exactly one chunk, anything else is rejected
+  static constexpr size_t CHUNK_VOLUME = LAYER_SIZE * EDGE;
+
+  enum Method : uint8_t {
+    rle = 0,
+    rleLz = 1,
+    columns = 2,
+    raw = 3,
+  };
+
+  // count has to be CHUNK_VOLUME. Picks the smallest of columns and rleLz, and stores
+  // the types as they are when neither is smaller than that
+  static std::vector<uint8_t> encode(const uint8_t *types, size_t count);
+  // returns false if the payload is malformed or does not hold a whole chunk
+  static bool decode(const uint8_t *payload, size_t size, std::vector<uint8_t> &types);
+
+ private:
+  static bool encodeColumns(const uint8_t *types, std::vector<uint8_t> &out);
+  static bool decodeColumns(const uint8_t *in, size_t size, uint8_t *types);
+  static void encodeRleLz(const uint8_t *types, std::vector<uint8_t> &out);
+  static bool decodeRleLz(const uint8_t *in, size_t size, uint8_t *types);
+
+  static void deltaLayers(const uint8_t *types, size_t count, uint8_t *out);
+  static void undeltaLayers(uint8_t *types, size_t count);
+  static void encodeRuns(const uint8_t *types, size_t count, std::vector<uint8_t> &out);
+  static bool decodeRuns(const uint8_t *in, size_t size, uint8_t *types, size_t count);
+  static void encodeLz(const uint8_t *in, size_t size, std::vector<uint8_t> &out);
+  static bool decodeLz(const uint8_t *in, size_t size, uint8_t *out, size_t outSize);
+};
+}
@@ -0,0 +1,286 @@
+#include "chunk_mesher.hpp"
+
+#include "SimplexNoise.hpp"
+
+#include <cassert>
+
+namespace zx {
+  namespace {
+    int voxelIndex(int x, int y, int z) { return (y * ChunkMesher::SIZE + z) * ChunkMesher::SIZE + x; }
+  }
+
+  MeshOptimizer::Stats ChunkMesher::build(Mesher mesher, int lod, glm::ivec3 origin, const Brickmap &brickmap, const Voxel *voxels, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices){
+    assert(lod >= 0 && lod < LOD_COUNT && "LOD out of range!");
+    vertices.clear();
+    indices.clear();
+    if(mesher == Mesher::surfaceNets){
+      surfaceNets(origin, lod, vertices, indices);
+      // cells are emitted in scan order, reordering roughly halves the vertex shader work
+      return MeshOptimizer::optimize(vertices, indices, false);
+    }
+    if(lod > 0){
+      blockyLod(brickmap, lod, vertices, indices);
+    } else {
+      blocky(brickmap, voxels, vertices, indices);
+    }
+    return MeshOptimizer::Stats{};
+  }
+
+  float ChunkMesher::terrainDensity(float x, float y, float z){
+    // continuous version of Chunk::terrainHeight, negative below the surface
+    return y - (SimplexNoise::noise(x, z)+1.f)*8.f;
+  }
+
+  void ChunkMesher::blocky(const Brickmap &brickmap, const Voxel *voxels, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices){
+    static const float voxel_vertices[] = {
+    0, 0, 0,
+    1, 0, 0,
+    1, 1, 0,
+    0, 1, 0,
+
+    0, 0, 1,
+    1, 0, 1,
+    1, 1, 1,
+    0, 1, 1
+    };
+
+    static int sz_vv = sizeof(voxel_vertices)/sizeof(voxel_vertices[0]);
+
+    static const uint32_t voxel_indices[] = {
+    1, 0, 3, 1, 3, 2, // north (-z)
+    4, 5, 6, 4, 6, 7, // south (+z)
+    5, 1, 2, 5, 2, 6, // east (+x)
+    0, 4, 7, 0, 7, 3, // west (-x)
+    2, 3, 7, 2, 7, 6, // top (+y)
+    5, 4, 0, 5, 0, 1, // bottom (-y)
+    };  
+
+    static const glm::vec3 voxel_normals[] = { {0.f, 0.f, -1.f}, {0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f} };
+    static int sz_vn = sizeof(voxel_normals)/sizeof(voxel_normals[0]);
+    
+    static int sz_vi = sizeof(voxel_indices)/sizeof(voxel_indices[0]);
+
+    for(int by = 0; by < Brickmap::BRICKS_PER_AXIS; by++){
+      for(int bz = 0; bz < Brickmap::BRICKS_PER_AXIS; bz++){
+        for(int bx = 0; bx < Brickmap::BRICKS_PER_AXIS; bx++){
+          // all-air bricks and full bricks enclosed by full bricks contribute no visible faces
+          if(!brickmap.isBrickOccupied(Brickmap::brickIndex(bx, by, bz)) || brickmap.isBrickBuried(bx, by, bz)){
+            continue;
+          }
+
+          for(int y = by*Brickmap::BRICK_EDGE; y < (by+1)*Brickmap::BRICK_EDGE; y++){
+            for(int z = bz*Brickmap::BRICK_EDGE; z < (bz+1)*Brickmap::BRICK_EDGE; z++){
+              for(int x = bx*Brickmap::BRICK_EDGE; x < (bx+1)*Brickmap::BRICK_EDGE; x++){
+                int j = voxelIndex(x, y, z);
+                if(voxels[j].type == air) continue;
+                uint32_t base = static_cast<uint32_t>(vertices.size());
+                for(int i = 0, k = 0; i < sz_vv; i+=3, i%6==0 ? k++ : k=k){
+                  Vertex vertex;
+
+                  float xx = voxel_vertices[i]+x;
+                  float yy = voxel_vertices[i+1]+y;
+                  float zz = voxel_vertices[i+2]+z;
+                  vertex.position = { xx, yy, zz };
+                  vertex.blockId = voxels[j].type;
+
+                  glm::vec3 vn = voxel_normals[k];
+                  vertex.normal = vn;
+
+                  vertices.push_back(vertex);
+                }
+                for(int i = 0; i < sz_vi; i++){
+                  indices.push_back(voxel_indices[i]+base);
+                }
+              } // x
+            } // z
+          } // y
+        } // bx
+      } // bz
+    } // by
+  }
+
+  void ChunkMesher::surfaceNets(glm::ivec3 origin, int lod, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices){
+    // the grid is sampled every 2^lod voxels, coordinates below are in those coarse cells
+    const int step = 1 << lod;
+    const int cells = SIZE >> lod;
+    // samples cover [-1, cells] so cells on the border see their neighbours and the surface
+    // lines up with the adjacent chunks
+    const int N = cells + 2;
+    auto sampleIndex = [N](int x, int y, int z) { return ((y + 1) * N + (z + 1)) * N + (x + 1); };
+
+    // the density only varies with height along a column, so the noise is sampled per column
+    std::vector<float> columnHeights(N * N);
+    for(int z = -1; z <= cells; z++){
+      for(int x = -1; x <= cells; x++){
+        columnHeights[(z + 1) * N + (x + 1)] = -terrainDensity(static_cast<float>(origin.x + x * step), 0.f, static_cast<float>(origin.z + z * step));
+      }
+    }
+    std::vector<float> density(N * N * N);
+    for(int y = -1; y <= cells; y++){
+      for(int z = -1; z <= cells; z++){
+        for(int x = -1; x <= cells; x++){
+          density[sampleIndex(x, y, z)] = static_cast<float>(origin.y + y * step) - columnHeights[(z + 1) * N + (x + 1)];
+        }
+      }
+    }
+
+    static const int cube_edges[12][2] = {
+      {0, 1}, {2, 3}, {4, 5}, {6, 7}, // x
+      {0, 2}, {1, 3}, {4, 6}, {5, 7}, // y
+      {0, 4}, {1, 5}, {2, 6}, {3, 7}, // z
+    };
+
+    // one vertex per cell the surface passes through, placed at the mean of its edge crossings
+    const int C = cells + 1;
+    auto cellIndex = [C](int x, int y, int z) { return ((y + 1) * C + (z + 1)) * C + (x + 1); };
+    std::vector<uint32_t> cellVertex(C * C * C, UINT32_MAX);
+    for(int y = -1; y < cells; y++){
+      for(int z = -1; z < cells; z++){
+        for(int x = -1; x < cells; x++){
+          float corner[8];
+          int mask = 0;
+          for(int c = 0; c < 8; c++){
+            corner[c] = density[sampleIndex(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1))];
+            mask |= (corner[c] < 0.f) << c;
+          }
+          if(mask == 0 || mask == 0xff) continue;
+
+          glm::vec3 sum{0.f};
+          int crossings = 0;
+          for(auto &edge : cube_edges){
+            float d0 = corner[edge[0]];
+            float d1 = corner[edge[1]];
+            if((d0 < 0.f) == (d1 < 0.f)) continue;
+            float t = d0 / (d0 - d1);
+            glm::vec3 p0{static_cast<float>(edge[0] & 1), static_cast<float>((edge[0] >> 1) & 1), static_cast<float>((edge[0] >> 2) & 1)};
+            glm::vec3 p1{static_cast<float>(edge[1] & 1), static_cast<float>((edge[1] >> 1) & 1), static_cast<float>((edge[1] >> 2) & 1)};
+            sum += p0 + (p1 - p0) * t;
+            crossings++;
+          }
+
+          glm::vec3 gradient{
+            (corner[1] - corner[0]) + (corner[3] - corner[2]) + (corner[5] - corner[4]) + (corner[7] - corner[6]),
+            (corner[2] - corner[0]) + (corner[3] - corner[1]) + (corner[6] - corner[4]) + (corner[7] - corner[5]),
+            (corner[4] - corner[0]) + (corner[5] - corner[1]) + (corner[6] - corner[2]) + (corner[7] - corner[3])};
+
+          Vertex vertex;
+          vertex.position = (glm::vec3{static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)} + sum / static_cast<float>(crossings)) * static_cast<float>(step);
+          vertex.normal = glm::normalize(gradient);
+          // no voxels to look at, upward facing slopes are grassed over
+          vertex.blockId = vertex.normal.y > 0.7f ? grass : stone;
+          cellVertex[cellIndex(x, y, z)] = static_cast<uint32_t>(vertices.size());
+          vertices.push_back(vertex);
+        }
+      }
+    }
+
+    // one quad per sign changing grid edge, joining the four cells around it. Edges are owned by
+    // the chunk their lower end point lies in so the border is not emitted twice
+    for(int y = 0; y < cells; y++){
+      for(int z = 0; z < cells; z++){
+        for(int x = 0; x < cells; x++){
+          float d0 = density[sampleIndex(x, y, z)];
+          for(int axis = 0; axis < 3; axis++){
+            glm::ivec3 p{x, y, z};
+            glm::ivec3 q = p;
+            q[axis] += 1;
+            float d1 = density[sampleIndex(q.x, q.y, q.z)];
+            if((d0 < 0.f) == (d1 < 0.f)) continue;
+
+            // the two axes perpendicular to the edge
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            glm::ivec3 around[4] = {p, p, p, p};
+            around[0][u] -= 1; around[0][v] -= 1;
+            around[1][v] -= 1;
+            around[3][u] -= 1;
+
+            uint32_t quad[4];
+            bool complete = true;
+            for(int c = 0; c < 4; c++){
+              quad[c] = cellVertex[cellIndex(around[c].x, around[c].y, around[c].z)];
+              complete = complete && quad[c] != UINT32_MAX;
+            }
+            if(!complete) continue;
+
+            // keep the winding facing out of the solid side
+            if(d0 < 0.f){
+              indices.insert(indices.end(), {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]});
+            } else {
+              indices.insert(indices.end(), {quad[0], quad[2], quad[1], quad[0], quad[3], quad[2]});
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void ChunkMesher::blockyLod(const Brickmap &brickmap, int lod, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices){
+    assert(lod > 0 && lod < LOD_COUNT && "LOD 0 is built by blocky!");
+
+    // corners of each face of the unit cube, in the order of the normals below
+    static const glm::vec3 face_corners[6][4] = {
+      {{1, 0, 0}, {0, 0, 0}, {0, 1, 0}, {1, 1, 0}}, // north (-z)
+      {{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}}, // south (+z)
+      {{1, 0, 1}, {1, 0, 0}, {1, 1, 0}, {1, 1, 1}}, // east (+x)
+      {{0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}}, // west (-x)
+      {{1, 1, 0}, {0, 1, 0}, {0, 1, 1}, {1, 1, 1}}, // top (+y)
+      {{1, 0, 1}, {0, 0, 1}, {0, 0, 0}, {1, 0, 0}}, // bottom (-y)
+    };
+    static const glm::ivec3 face_normals[6] = { {0, 0, -1}, {0, 0, 1}, {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0} };
+
+    const int scale = 1 << lod;
+    const int cells = SIZE / scale;
+
+    // a coarse cell is solid when any voxel inside it is, so the coarse surface never dips below the full detail one
+    std::vector<bool> solid(cells * cells * cells);
+    auto cellIndex = [cells](int x, int y, int z) { return (y * cells + z) * cells + x; };
+    for(int y = 0; y < cells; y++){
+      for(int z = 0; z < cells; z++){
+        for(int x = 0; x < cells; x++){
+          glm::ivec3 min = glm::ivec3{x, y, z} * scale;
+          solid[cellIndex(x, y, z)] = !brickmap.isRegionEmpty(min, min + glm::ivec3{scale});
+        }
+      }
+    }
+
+    for(int y = 0; y < cells; y++){
+      for(int z = 0; z < cells; z++){
+        for(int x = 0; x < cells; x++){
+          if(!solid[cellIndex(x, y, z)]) continue;
+
+          // the cell is on the surface when nothing solid lies on top of it in this chunk
+          bool surface = y + 1 == cells || !solid[cellIndex(x, y + 1, z)];
+
+          for(int f = 0; f < 6; f++){
+            glm::ivec3 n = glm::ivec3{x, y, z} + face_normals[f];
+            bool inside = n.x >= 0 && n.y >= 0 && n.z >= 0 && n.x < cells && n.y < cells && n.z < cells;
+            if(inside && solid[cellIndex(n.x, n.y, n.z)]) continue;
+
+            // side faces on the chunk border become skirts: only surface cells emit them, hanging
+            // SKIRT_DEPTH voxels below the cell to hide the cracks against a neighbouring chunk
+            // drawn at a different LOD. Buried border faces are covered by the skirt above them
+            bool skirt = !inside && f < 4;
+            if(skirt && !surface) continue;
+
+            uint32_t base = static_cast<uint32_t>(vertices.size());
+            for(int c = 0; c < 4; c++){
+              Vertex vertex;
+              vertex.position = (glm::vec3{static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)} + face_corners[f][c]) * static_cast<float>(scale);
+              if(skirt && face_corners[f][c].y == 0.f){
+                vertex.position.y -= static_cast<float>(SKIRT_DEPTH);
+              }
+              vertex.normal = glm::vec3{face_normals[f]};
+              // coarse cells mix types, the top faces are the terrain surface
+              vertex.blockId = f == 4 ? grass : stone;
+              vertices.push_back(vertex);
+            }
+            for(uint32_t i : {0u, 1u, 2u, 0u, 2u, 3u}){
+              indices.push_back(base + i);
+            }
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "defines.hpp"
+#include "brickmap.hpp"
+#include "mesh_optimizer.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace zx {
+  enum VoxelType{
+    air = 0,
+    stone = 1,
+    grass = 2
+  };
+
+  struct Voxel {
+    glm::vec3 position{};
+    VoxelType type{};
+
+    bool operator==(const Voxel &other) const {
+      return type == other.type;
+    }
+  };
+
+  // Builds chunk meshes into plain vertex and index arrays. Nothing here touches the device,
+  // Chunk uploads the result, and benchmarks/chunk_mesher_bench.cpp runs the meshers on their own.
+  class ChunkMesher {
+    public:
+      static constexpr int SIZE = Brickmap::EDGE;
+      // LOD n is meshed from 2^n voxel wide cells
+      static constexpr int LOD_COUNT = 4;
+      // how far below the surface blocky LOD border skirts reach, the height of the coarsest cell
+      // covers the largest step between the surfaces of two neighbouring LODs
+      static constexpr int SKIRT_DEPTH = 1 << (LOD_COUNT - 1);
+
+      enum class Mesher {
+        blocky,
+        surfaceNets
+      };
+
+      struct Vertex {
+        glm::vec3 position{};
+        glm::vec3 normal{};
+        // VoxelType of the face, selects the layer of the block texture array
+        uint32_t blockId = stone;
+
+        bool operator==(const Vertex &other) const {
+          return position == other.position && normal == other.normal && blockId == other.blockId;
+        }
+      };
+
+      // replaces vertices and indices with the chunk's mesh at lod. voxels are in Chunk::voxelIndex
+      // order, origin is the world voxel coordinate of the chunk corner.
+      // blocky meshes LOD 0 from the voxels and coarser LODs from the brickmap, with skirts on the
+      // border. Surface nets meshes every LOD from terrainDensity sampled at the LOD's cell size;
+      // it has no skirts, neighbouring chunks at different LODs can show thin cracks between them.
+      // Only surface nets output goes through MeshOptimizer, the returned stats are zero for blocky
+      static MeshOptimizer::Stats build(Mesher mesher, int lod, glm::ivec3 origin, const Brickmap &brickmap, const Voxel *voxels, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+      static float terrainDensity(float x, float y, float z);
+
+    private:
+      static void blocky(const Brickmap &brickmap, const Voxel *voxels, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+      static void blockyLod(const Brickmap &brickmap, int lod, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+      // smooth surface through the zero crossing of terrainDensity, using naive surface nets
+      static void surfaceNets(glm::ivec3 origin, int lod, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+  };
+}
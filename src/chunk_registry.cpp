@@ -0,0 +1,228 @@
+#include "chunk_registry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace zx {
+
+namespace {
+constexpr size_t INITIAL_CAPACITY = 256;
+
+int floorDiv(int a, int b) { return (a >= 0 ? a : a - b + 1) / b; }
+}  // namespace
+
+const std::array<glm::ivec3, 6> ChunkRegistry::NEIGHBOUR_OFFSETS = {
+    glm::ivec3{1, 0, 0},
+    glm::ivec3{-1, 0, 0},
+    glm::ivec3{0, 1, 0},
+    glm::ivec3{0, -1, 0},
+    glm::ivec3{0, 0, 1},
+    glm::ivec3{0, 0, -1}};
+
+ChunkRegistry::ChunkRegistry() {
+  slots.resize(INITIAL_CAPACITY);
+  mask = INITIAL_CAPACITY - 1;
+}
+
+size_t ChunkRegistry::hash(glm::ivec3 coord) {
+  uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) * 0x9E3779B97F4A7C15ull) ^
+                 (static_cast<uint64_t>(static_cast<uint32_t>(coord.y)) * 0xC2B2AE3D27D4EB4Full) ^
+                 (static_cast<uint64_t>(static_cast<uint32_t>(coord.z)) * 0x165667B19E3779F9ull);
+  // fold the well mixed high bits into the ones used by the mask
+  return static_cast<size_t>(key ^ (key >> 29));
+}
+
+size_t ChunkRegistry::findSlot(glm::ivec3 coord) const {
+  size_t i = hash(coord) & mask;
+  while (slots[i].used && slots[i].entry.coord != coord) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+void ChunkRegistry::insert(glm::ivec3 coord, Chunk *chunk, Entity entity) {
+  if ((count + 1) * 2 > slots.size()) grow();
+
+  Slot &slot = slots[findSlot(coord)];
+  if (!slot.used) count++;
+  // boundsMin above boundsMax marks empty bounds
+  if (boundsMin.x > boundsMax.x) {
+    boundsMin = coord;
+    boundsMax = coord;
+  } else {
+    boundsMin = glm::min(boundsMin, coord);
+    boundsMax = glm::max(boundsMax, coord);
+  }
+  slot.used = true;
+  slot.entry = Entry{coord, chunk, entity};
+}
+
+bool ChunkRegistry::erase(glm::ivec3 coord) {
+  size_t i = findSlot(coord);
+  if (!slots[i].used) return false;
+
+  // backward shift deletion, moves later entries of the probe run into the hole so
+  // lookups never need tombstones
+  size_t hole = i;
+  size_t j = i;
+  while (true) {
+    j = (j + 1) & mask;
+    if (!slots[j].used) break;
+    size_t home = hash(slots[j].entry.coord) & mask;
+    // entry at j may only move to the hole if the hole is not before its home slot
+    bool movable = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+    if (movable) {
+      slots[hole] = slots[j];
+      hole = j;
+    }
+  }
+  slots[hole] = Slot{};
+  count--;
+  // streaming unloads whole rows at once, so rescanning is left to the next raycast
+  if (glm::any(glm::equal(coord, boundsMin)) || glm::any(glm::equal(coord, boundsMax))) {
+    boundsDirty = true;
+  }
+  return true;
+}
+
+void ChunkRegistry::clear() {
+  for (Slot &slot : slots) slot = Slot{};
+  count = 0;
+  boundsMin = glm::ivec3{0};
+  boundsMax = glm::ivec3{-1};
+  boundsDirty = false;
+}
+
+void ChunkRegistry::updateBounds() const {
+  boundsMin = glm::ivec3{0};
+  boundsMax = glm::ivec3{-1};
+  bool empty = true;
+  for (const Slot &slot : slots) {
+    if (!slot.used) continue;
+    boundsMin = empty ? slot.entry.coord : glm::min(boundsMin, slot.entry.coord);
+    boundsMax = empty ? slot.entry.coord : glm::max(boundsMax, slot.entry.coord);
+    empty = false;
+  }
+  boundsDirty = false;
+}
+
+void ChunkRegistry::grow() {
+  std::vector<Slot> old = std::move(slots);
+  slots.assign(old.size() * 2, Slot{});
+  mask = slots.size() - 1;
+  for (const Slot &slot : old) {
+    if (slot.used) slots[findSlot(slot.entry.coord)] = slot;
+  }
+}
+
+const ChunkRegistry::Entry *ChunkRegistry::find(glm::ivec3 coord) const {
+  const Slot &slot = slots[findSlot(coord)];
+  return slot.used ? &slot.entry : nullptr;
+}
+
+std::array<Chunk *, 6> ChunkRegistry::getNeighbours(glm::ivec3 coord) const {
+  std::array<Chunk *, 6> neighbours{};
+  for (size_t i = 0; i < NEIGHBOUR_OFFSETS.size(); i++) {
+    neighbours[i] = getChunk(coord + NEIGHBOUR_OFFSETS[i]);
+  }
+  return neighbours;
+}
+
+glm::ivec3 ChunkRegistry::chunkCoord(glm::ivec3 worldVoxel) {
+  return glm::ivec3{
+      floorDiv(worldVoxel.x, Chunk::SIZE),
+      floorDiv(worldVoxel.y, Chunk::SIZE),
+      floorDiv(worldVoxel.z, Chunk::SIZE)};
+}
+
+VoxelType ChunkRegistry::getVoxel(glm::ivec3 worldVoxel) const {
+  glm::ivec3 coord = chunkCoord(worldVoxel);
+  Chunk *chunk = getChunk(coord);
+  if (chunk == nullptr) return air;
+  glm::ivec3 local = worldVoxel - coord * Chunk::SIZE;
+  return chunk->getVoxel(local.x, local.y, local.z);
+}
+
+bool ChunkRegistry::setVoxel(glm::ivec3 worldVoxel, VoxelType type) {
+  glm::ivec3 coord = chunkCoord(worldVoxel);
+  Chunk *chunk = getChunk(coord);
+  if (chunk == nullptr) return false;
+  glm::ivec3 local = worldVoxel - coord * Chunk::SIZE;
+  chunk->setVoxel(local.x, local.y, local.z, type);
+  return true;
+}
+
+bool ChunkRegistry::raycast(
+    glm::vec3 origin, glm::vec3 direction, float maxDistance, Brickmap::RaycastHit &hit) const {
+  float length = glm::length(direction);
+  if (count == 0 || length <= 0.f) return false;
+  direction /= length;
+  if (boundsDirty) updateBounds();
+
+  const float size = static_cast<float>(Chunk::SIZE);
+  const float inf = std::numeric_limits<float>::infinity();
+
+  // clip the ray against the box around the loaded chunks, nothing outside it can be hit
+  glm::vec3 boxMin = glm::vec3(boundsMin) * size;
+  glm::vec3 boxMax = glm::vec3(boundsMax + glm::ivec3{1}) * size;
+  float tEnter = 0.f;
+  float tExit = maxDistance;
+  for (int a = 0; a < 3; a++) {
+    if (direction[a] == 0.f) {
+      if (origin[a] < boxMin[a] || origin[a] > boxMax[a]) return false;
+      continue;
+    }
+    float t0 = (boxMin[a] - origin[a]) / direction[a];
+    float t1 = (boxMax[a] - origin[a]) / direction[a];
+    if (t0 > t1) std::swap(t0, t1);
+    tEnter = std::max(tEnter, t0);
+    tExit = std::min(tExit, t1);
+  }
+  if (tEnter > tExit) return false;
+
+  // Amanatides & Woo over the chunk grid from where the ray enters the box, each loaded
+  // chunk is handed to its brickmap
+  glm::vec3 enter = origin + direction * tEnter;
+  glm::ivec3 cell{};
+  glm::ivec3 step{};
+  glm::vec3 tMax{};
+  glm::vec3 tDelta{};
+  for (int a = 0; a < 3; a++) {
+    cell[a] = std::clamp(static_cast<int>(std::floor(enter[a] / size)), boundsMin[a], boundsMax[a]);
+    if (direction[a] > 0.f) {
+      step[a] = 1;
+      tMax[a] = ((cell[a] + 1) * size - origin[a]) / direction[a];
+      tDelta[a] = size / direction[a];
+    } else if (direction[a] < 0.f) {
+      step[a] = -1;
+      tMax[a] = (cell[a] * size - origin[a]) / direction[a];
+      tDelta[a] = -size / direction[a];
+    } else {
+      step[a] = 0;
+      tMax[a] = inf;
+      tDelta[a] = inf;
+    }
+  }
+
+  float t = tEnter;
+  while (t <= tExit) {
+    Chunk *chunk = getChunk(cell);
+    if (chunk != nullptr) {
+      glm::vec3 chunkOrigin = glm::vec3(cell) * size;
+      if (chunk->brickmap.raycast(origin - chunkOrigin, direction, maxDistance, hit)) {
+        hit.voxel += cell * Chunk::SIZE;
+        return true;
+      }
+    }
+
+    int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+    t = tMax[axis];
+    cell[axis] += step[axis];
+    if (cell[axis] < boundsMin[axis] || cell[axis] > boundsMax[axis]) break;
+    tMax[axis] += tDelta[axis];
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "defines.hpp"
+#include "brickmap.hpp"
+#include "chunk.hpp"
+#include "zx_scene.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zx {
+
+// Loaded chunks by integer chunk coordinate (world voxel origin / Chunk::SIZE).
+// Open addressing with linear probing over a power of two table kept at most half full,
+// so a lookup is a hash and usually one or two slot compares. Chunks are owned by their
+// scene entities, the registry only points at them.
+class ChunkRegistry {
+ public:
+  struct Entry {
+    glm::ivec3 coord{};
+    Chunk *chunk = nullptr;
+    Entity entity = 0;
+  };
+
+  // order of Chunk faces: +x, -x, +y, -y, +z, -z
+  static const std::array<glm::ivec3, 6> NEIGHBOUR_OFFSETS;
+
+  ChunkRegistry();
+
+  ChunkRegistry(const ChunkRegistry &) = delete;
+  ChunkRegistry &operator=(const ChunkRegistry &) = delete;
+
+  // replaces any chunk already registered at coord
+  void insert(glm::ivec3 coord, Chunk *chunk, Entity entity);
+  bool erase(glm::ivec3 coord);
+  void clear();
+
+  const Entry *find(glm::ivec3 coord) const;
+  Chunk *getChunk(glm::ivec3 coord) const {
+    const Entry *entry = find(coord);
+    return entry ? entry->chunk : nullptr;
+  }
+  bool contains(glm::ivec3 coord) const { return find(coord) != nullptr; }
+  // chunks sharing a face with coord, nullptr where none is loaded
+  std::array<Chunk *, 6> getNeighbours(glm::ivec3 coord) const;
+
+  size_t size() const { return count; }
+
+  template <typename Fn>
+  void forEach(Fn &&fn) const {
+    for (const Slot &slot : slots) {
+      if (slot.used) fn(slot.entry);
+    }
+  }
+
+  static glm::ivec3 chunkCoord(glm::ivec3 worldVoxel);
+
+  // voxels in world coordinates, unloaded chunks read as air and ignore writes
+  VoxelType getVoxel(glm::ivec3 worldVoxel) const;
+  bool setVoxel(glm::ivec3 worldVoxel, VoxelType type);
+
+  // walks the loaded chunks along the ray, hit.voxel is in world voxel coordinates. The walk
+  // is clipped to the box around the loaded chunks, so an infinite maxDistance is fine
+  bool raycast(
+      glm::vec3 origin,
+      glm::vec3 direction,
+      float maxDistance,
+      Brickmap::RaycastHit &hit) const;
+
+ private:
+  struct Slot {
+    Entry entry{};
+    bool used = false;
+  };
+
+  static size_t hash(glm::ivec3 coord);
+  size_t findSlot(glm::ivec3 coord) const;
+  void grow();
+  // recomputes the bounds from the live slots after an erase on their border
+  void updateBounds() const;
+
+  std::vector<Slot> slots;
+  size_t mask = 0;
+  size_t count = 0;
+  // chunk coordinates every loaded chunk lies within. insert grows them, erasing a chunk on
+  // their border only marks them dirty and the next raycast shrinks them
+  mutable glm::ivec3 boundsMin{0};
+  mutable glm::ivec3 boundsMax{-1};
+  mutable bool boundsDirty = false;
+};
+}
@@ -4,14 +4,18 @@
 #include "keyboard_movement_controller.hpp"
 #include "zx_buffer.hpp"
 #include "zx_camera.hpp"
-#include "zx_game_object.hpp"
+#include "zx_pipeline_queue.hpp"
+#include "zx_scene.hpp"
 #include "zx_texture.hpp"
+#include "systems/clipmap_render_system.hpp"
 #include "systems/simple_render_system.hpp"
 #include "systems/voxel_render_system.hpp"
 
 #include "zx_utils.hpp"
 
 #include "chunk.hpp"
+#include "chunk_codec.hpp"
+#include "terrain_clipmap.hpp"
 
 #include "SimplexNoise.hpp"
 
@@ -20,6 +24,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <array>
 #include <cassert>
@@ -27,23 +32,33 @@
 #include <stdexcept>
 #include <iostream>
 #include <bit>
+#include <cmath>
 
 namespace zx {
       std::vector<float> heightValues;
-FirstApp::FirstApp() {
+FirstApp::FirstApp(int framesInFlight, FramePacing framePacing, Chunk::Mesher chunkMesher)
+    : zxRenderer{zxWindow, zxDevice, framesInFlight},
+      commandRecorder{zxDevice, RECORDING_THREADS, zxRenderer.getFramesInFlight()},
+      chunkMesher{chunkMesher} {
+  zxRenderer.setFramePacing(framePacing);
+  int frames = zxRenderer.getFramesInFlight();
+  info("Frames in flight: " + std::to_string(frames), 1);
+  info(std::string{"Chunk mesher: "} + (chunkMesher == Chunk::Mesher::surfaceNets ? "surface nets" : "blocky"), 1);
   globalPool =
       ZxDescriptorPool::Builder(zxDevice)
-          .setMaxSets(ZxSwapChain::MAX_FRAMES_IN_FLIGHT)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, ZxSwapChain::MAX_FRAMES_IN_FLIGHT)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, ZxSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .setMaxSets(frames)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frames)
           .build();
-  loadGameObjects();
+  retiredChunks.resize(frames);
+  retiredMeshes.resize(frames);
 }
 
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {
-  std::vector<std::unique_ptr<ZxBuffer>> uboBuffers(ZxSwapChain::MAX_FRAMES_IN_FLIGHT);
+  const int framesInFlight = zxRenderer.getFramesInFlight();
+  std::vector<std::unique_ptr<ZxBuffer>> uboBuffers(framesInFlight);
   for (int i = 0; i < uboBuffers.size(); i++) {
     uboBuffers[i] = std::make_unique<ZxBuffer>(
         zxDevice,
@@ -53,47 +68,125 @@ void FirstApp::run() {
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
     uboBuffers[i]->map();
   }
+  std::vector<std::unique_ptr<ZxBuffer>> objectBuffers(framesInFlight);
+  for (int i = 0; i < objectBuffers.size(); i++) {
+    objectBuffers[i] = std::make_unique<ZxBuffer>(
+        zxDevice,
+        sizeof(ObjectData),
+        MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    objectBuffers[i]->map();
+  }
   auto globalSetLayout =
     ZxDescriptorSetLayout::Builder(zxDevice)
-          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
           .build();
 
-  Texture texture = Texture(zxDevice, "../textures/voronoi.png");
+  // decoded in the background, objects given its handle in scene.textures sample the
+  // placeholder until it is ready
+  ZxTextureLoader::Handle voronoiTexture = textureLoader.load("../textures/voronoi.png");
 
-  VkDescriptorImageInfo imageInfo{};
-  imageInfo.sampler = texture.getSampler();
-  imageInfo.imageView = texture.getImageView();
-  imageInfo.imageLayout = texture.getImageLayout();
+  // two quads sharing one model, one textured and one on the default texture, so both
+  // paths of the bindless lookup are drawn in the same instanced draw
+  std::shared_ptr<ZxModel> quadModel = ZxModel::createModelFromFile(zxDevice, "models/quad.obj");
+  for (float x : {-1.5f, 1.5f}) {
+    Entity quad = scene.createEntity();
+    TransformComponent transform{};
+    transform.translation = {x, -2.f, 4.f};
+    scene.transforms.add(quad, transform);
+    scene.models.add(quad, quadModel);
+    if (x < 0.f) scene.textures.add(quad, voronoiTexture);
+  }
+
+  // 10296 triangles, above ZxModel::MIN_MESHLET_TRIANGLES, so the meshlet culling pass runs
+  std::shared_ptr<ZxModel> vaseModel = ZxModel::createModelFromFile(zxDevice, "models/smooth_vase.obj");
+  Entity vase = scene.createEntity();
+  TransformComponent vaseTransform{};
+  vaseTransform.translation = {0.f, -2.f, 6.f};
+  vaseTransform.scale = {3.f, 1.5f, 3.f};
+  scene.transforms.add(vase, vaseTransform);
+  scene.models.add(vase, vaseModel);
 
-  std::vector<VkDescriptorSet> globalDescriptorSets(ZxSwapChain::MAX_FRAMES_IN_FLIGHT);
+  std::vector<VkDescriptorSet> globalDescriptorSets(framesInFlight);
   for (int i = 0; i < globalDescriptorSets.size(); i++) {
     auto uboInfo = uboBuffers[i]->descriptorInfo();
+    auto objectInfo = objectBuffers[i]->descriptorInfo();
     ZxDescriptorWriter(*globalSetLayout, *globalPool)
         .writeBuffer(0, &uboInfo)
-        .writeImage(1, &imageInfo)
+        .writeBuffer(2, &objectInfo)
         .build(globalDescriptorSets[i]);
   }
 
+  // systems only queue their pipelines, they are compiled together below
+  ZxPipelineQueue pipelineQueue{zxDevice};
+
   SimpleRenderSystem simple_render_system{
       zxDevice,
+      pipelineQueue,
       zxRenderer.getSwapChainRenderPass(),
-      globalSetLayout->getDescriptorSetLayout()};
+      globalSetLayout->getDescriptorSetLayout(),
+      bindlessSet.getSetLayout(),
+      framesInFlight};
 
   VoxelRenderSystem voxel_render_system{
       zxDevice,
+      pipelineQueue,
       zxRenderer.getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout()};
 
+  ClipmapRenderSystem clipmap_render_system{
+      zxDevice,
+      pipelineQueue,
+      zxRenderer.getSwapChainRenderPass(),
+      globalSetLayout->getDescriptorSetLayout(),
+      framesInFlight};
+
+  pipelineQueue.build();
+
+  // far terrain around the chunks streamed in by streamChunks
+  TerrainClipmap terrainClipmap{};
+
   ZxCamera camera{};
 
-  auto viewerObject = ZxGameObject::createGameObject();
-  viewerObject.transform.translation = {0.f, 0.f, 0.f};
-  viewerObject.transform.rotation = {0.f, 0.f, 0.f};
+  TransformComponent viewerTransform{};
+  viewerTransform.translation = {0.f, 0.f, 0.f};
+  viewerTransform.rotation = {0.f, 0.f, 0.f};
   KeyboardMovementController cameraController{};
   float dt = 0.f;
   auto currentTime = std::chrono::high_resolution_clock::now();
+
+  // Input to GPU completion latency: when beginFrame returns, the fence of the frame that
+  // last used this frame index has signalled, so that frame's input is this old at most.
+  // More frames in flight keep the GPU busier but let the CPU run further ahead of it.
+  std::vector<std::chrono::high_resolution_clock::time_point> inputTimes(framesInFlight);
+  std::vector<bool> inputTimeValid(framesInFlight, false);
+  auto statsStart = currentTime;
+  int statsFrames = 0;
+  int statsLatencyFrames = 0;
+  float statsLatency = 0.f;
+
   while (!zxWindow.shouldClose()) {
+    // all the waiting for the GPU and the display happens in beginFrame
+    auto commandBuffer = zxRenderer.beginFrame();
+    auto frameStart = std::chrono::high_resolution_clock::now();
+
+    // streaming, meshing and texture uploads are the slow part of the CPU frame, they run
+    // before input is sampled and work from the previous frame's camera
+    if (commandBuffer) {
+      int frameIndex = zxRenderer.getFrameIndex();
+      // textures that became ready get new bindless slots, this frame's object data is the
+      // first to point at them
+      textureLoader.update();
+
+      streamChunks(camera.getPosition(), frameIndex);
+      updateChunkMeshes(camera.getPosition(), frameIndex, voxel_render_system);
+      terrainClipmap.setVoxelRegion(streamedRegion());
+      terrainClipmap.update(camera.getPosition());
+    }
+
+    // input is sampled as late as possible, right before the camera goes into the ubo
     glfwPollEvents();
 
     auto newTime = std::chrono::high_resolution_clock::now();
@@ -101,21 +194,24 @@ void FirstApp::run() {
         std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
     currentTime = newTime;
 
-    cameraController.moveInPlaneXZ(zxWindow.getGLFWwindow(), frameTime, viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+    cameraController.moveInPlaneXZ(zxWindow.getGLFWwindow(), frameTime, viewerTransform);
+    camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
     float aspect = zxRenderer.getAspectRatio();
-    camera.setPerspectiveProjection(glm::radians(60.0f), (float)zxWindow.getExtent().width / (float)zxWindow.getExtent().height, 0.1f, 512.0f);
+    // far plane reaches the outermost clipmap level
+    camera.setPerspectiveProjection(glm::radians(60.0f), (float)zxWindow.getExtent().width / (float)zxWindow.getExtent().height, 0.1f, 2048.0f);
     
-    if (auto commandBuffer = zxRenderer.beginFrame()) {
+    if (commandBuffer) {
       int frameIndex = zxRenderer.getFrameIndex();
+
       FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          gameObjects};
+          bindlessSet.getDescriptorSet(),
+          scene};
       dt += frameTime/10.f;
       // update
 
@@ -130,32 +226,223 @@ void FirstApp::run() {
       uboBuffers[frameIndex]->writeToBuffer(&ubo);
       uboBuffers[frameIndex]->flush();
 
-      zxRenderer.beginSwapChainRenderPass(commandBuffer);
+      if (inputTimeValid[frameIndex]) {
+        statsLatency += std::chrono::duration<float, std::chrono::milliseconds::period>(
+                            frameStart - inputTimes[frameIndex])
+                            .count();
+        statsLatencyFrames++;
+      }
+      inputTimes[frameIndex] = newTime;
+      inputTimeValid[frameIndex] = true;
+      statsFrames++;
+
+      float statsTime =
+          std::chrono::duration<float, std::chrono::seconds::period>(frameStart - statsStart).count();
+      if (statsTime >= 2.f) {
+        float latency = statsLatencyFrames > 0 ? statsLatency / statsLatencyFrames : 0.f;
+        info(
+            std::to_string(framesInFlight) + " frames in flight" +
+                (zxRenderer.getFramePacing() == FramePacing::lowLatency ? ", low latency: " : ": ") +
+                std::to_string(statsFrames / statsTime) + " fps, " + std::to_string(latency) +
+                " ms input latency",
+            0);
+        if (meshAcmrCount > 0) {
+          info(
+              std::to_string(meshAcmrCount) + " chunk meshes optimized, ACMR " +
+                  std::to_string(meshAcmr.acmrBefore / meshAcmrCount) + " -> " +
+                  std::to_string(meshAcmr.acmrAfter / meshAcmrCount),
+              0);
+        }
+        meshAcmr = MeshOptimizer::Stats{};
+        meshAcmrCount = 0;
+        statsStart = frameStart;
+        statsFrames = 0;
+        statsLatencyFrames = 0;
+        statsLatency = 0.f;
+      }
+
+      // only transforms that changed pay for the trig, the buffer is rewritten every frame
+      scene.updateTransforms();
+      scene.writeObjectData(
+          static_cast<ObjectData *>(objectBuffers[frameIndex]->getMappedMemory()),
+          MAX_OBJECTS,
+          textureLoader.getTextureIndices());
+      objectBuffers[frameIndex]->flush();
 
-      simple_render_system.renderGameObjects(frameInfo);
-      voxel_render_system.renderChunks(frameInfo);
+      // meshlet culling is a compute pass, it has to be recorded before the render pass begins
+      simple_render_system.prepare(frameInfo);
 
+      // every system records into its own secondaries, chunks are split in one range per thread
+      auto withCommandBuffer = [&](VkCommandBuffer secondary) {
+        FrameInfo info = frameInfo;
+        info.commandBuffer = secondary;
+        return info;
+      };
+      std::vector<ZxCommandRecorder::Job> jobs;
+      jobs.push_back([&](VkCommandBuffer secondary) {
+        FrameInfo info = withCommandBuffer(secondary);
+        simple_render_system.renderGameObjects(info);
+      });
+      size_t chunkCount = scene.chunks.size();
+      size_t rangeCount = commandRecorder.getThreadCount();
+      for (size_t range = 0; range < rangeCount; range++) {
+        size_t first = chunkCount * range / rangeCount;
+        size_t last = chunkCount * (range + 1) / rangeCount;
+        if (first == last) continue;
+        jobs.push_back([&, first, last](VkCommandBuffer secondary) {
+          FrameInfo info = withCommandBuffer(secondary);
+          voxel_render_system.renderChunks(info, first, last);
+        });
+      }
+      jobs.push_back([&](VkCommandBuffer secondary) {
+        FrameInfo info = withCommandBuffer(secondary);
+        clipmap_render_system.renderTerrain(info, terrainClipmap);
+      });
+
+      commandRecorder.beginFrame(frameIndex);
+      std::vector<VkCommandBuffer> secondaries = commandRecorder.record(
+          frameIndex,
+          zxRenderer.getSwapChainRenderPass(),
+          zxRenderer.getCurrentFramebuffer(),
+          zxRenderer.getSwapChainExtent(),
+          jobs);
+
+      zxRenderer.beginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+      vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
       zxRenderer.endSwapChainRenderPass(commandBuffer);
       zxRenderer.endFrame();
     }
   }
 
   vkDeviceWaitIdle(zxDevice.device());
+  saveChunks();
 }
 
 
-void FirstApp::loadGameObjects() {
-  for(int y = 0; y < 1; y++){
-    for(int z = 0; z < 8; z++){
-      for(int x = 0; x < 8; x++){
-        ZxGameObject chunk_game_object = ZxGameObject::createChunk(glm::vec3(x*32.f, y*32.f, z*32.f));
-        chunk_game_object.chunk = std::make_unique<Chunk>(zxDevice);
-        chunk_game_object.chunk->intializeChunk();
-        chunk_game_object.chunk->createMesh();
-        gameObjects.emplace(chunk_game_object.getId(), std::move(chunk_game_object));
+void FirstApp::streamChunks(glm::vec3 cameraPosition, int frameIndex) {
+  // the frame that last used these has finished, its fence was waited on by beginFrame
+  retiredChunks[frameIndex].clear();
+  retiredMeshes[frameIndex].clear();
+
+  streamCenter = glm::ivec3{
+      static_cast<int>(std::floor(cameraPosition.x / Chunk::SIZE)),
+      0,
+      static_cast<int>(std::floor(cameraPosition.z / Chunk::SIZE))};
+  auto inRange = [&](glm::ivec3 coord) {
+    return std::abs(coord.x - streamCenter.x) <= VIEW_DISTANCE &&
+           std::abs(coord.z - streamCenter.z) <= VIEW_DISTANCE;
+  };
+
+  std::vector<ChunkRegistry::Entry> outOfRange;
+  chunkRegistry.forEach([&](const ChunkRegistry::Entry &entry) {
+    if (!inRange(entry.coord)) outOfRange.push_back(entry);
+  });
+  for (auto &entry : outOfRange) {
+    chunkRegistry.erase(entry.coord);
+    unloadChunk(std::move(scene.chunks.get(entry.entity)), frameIndex);
+    scene.destroyEntity(entry.entity);
+  }
+
+  // nearest rings first, a few chunks per frame to keep frame times even
+  int loads = 0;
+  for (int ring = 0; ring <= VIEW_DISTANCE && loads < MAX_CHUNK_LOADS_PER_FRAME; ring++) {
+    for (int dz = -ring; dz <= ring && loads < MAX_CHUNK_LOADS_PER_FRAME; dz++) {
+      for (int dx = -ring; dx <= ring && loads < MAX_CHUNK_LOADS_PER_FRAME; dx++) {
+        if (std::max(std::abs(dx), std::abs(dz)) != ring) continue;
+        glm::ivec3 coord = streamCenter + glm::ivec3{dx, 0, dz};
+        if (chunkRegistry.contains(coord)) continue;
+
+        std::unique_ptr<Chunk> chunk = loadChunk(coord);
+        Chunk *chunkPtr = chunk.get();
+        chunkRegistry.insert(coord, chunkPtr, scene.createChunk(std::move(chunk)));
+        loads++;
       }
     }
   }
 }
 
+std::unique_ptr<Chunk> FirstApp::loadChunk(glm::ivec3 coord) {
+  auto chunk = std::make_unique<Chunk>(zxDevice);
+  chunk->mesher = chunkMesher;
+  glm::ivec3 origin = coord * Chunk::SIZE;
+
+  // recently unloaded chunks are still in memory, explored ones come back from the
+  // region files, new ones are generated and saved
+  std::vector<uint8_t> types;
+  constexpr size_t voxelCount = Chunk::SIZE * Chunk::SIZE * Chunk::SIZE;
+  static_assert(voxelCount == ChunkCodec::CHUNK_VOLUME, "Chunk codec has to match the chunk size!");
+  if (coldChunks.load(coord, types) && types.size() == voxelCount) {
+    chunk->loadVoxelTypes(origin, types);
+  } else if (worldStorage.loadChunk(coord, types) && types.size() == voxelCount) {
+    chunk->loadVoxelTypes(origin, types);
+  } else {
+    chunk->intializeChunk(origin);
+    worldStorage.saveChunk(coord, chunk->getVoxelTypes());
+  }
+  // meshed by updateChunkMeshes at the LOD it is drawn at
+  return chunk;
+}
+
+void FirstApp::updateChunkMeshes(
+    glm::vec3 cameraPosition, int frameIndex, const VoxelRenderSystem &voxelRenderSystem) {
+  struct Rebuild {
+    Chunk *chunk;
+    int lod;
+    float distance;
+  };
+  std::vector<Rebuild> rebuilds;
+  chunkRegistry.forEach([&](const ChunkRegistry::Entry &entry) {
+    glm::vec3 origin{entry.chunk->origin};
+    int lod = voxelRenderSystem.selectLod(cameraPosition, origin);
+    if (lod == entry.chunk->meshLod && !entry.chunk->meshDirty) return;
+    float distance = glm::length(origin + glm::vec3{Chunk::SIZE * 0.5f} - cameraPosition);
+    rebuilds.push_back(Rebuild{entry.chunk, lod, distance});
+  });
+
+  // chunks without any mesh go first, they are holes in the terrain
+  size_t count = std::min(rebuilds.size(), static_cast<size_t>(MAX_CHUNK_MESHES_PER_FRAME));
+  std::partial_sort(
+      rebuilds.begin(), rebuilds.begin() + count, rebuilds.end(), [](const Rebuild &a, const Rebuild &b) {
+        bool aMissing = a.chunk->meshLod < 0;
+        bool bMissing = b.chunk->meshLod < 0;
+        if (aMissing != bMissing) return aMissing;
+        return a.distance < b.distance;
+      });
+  for (size_t i = 0; i < count; i++) {
+    Chunk *chunk = rebuilds[i].chunk;
+    retiredMeshes[frameIndex].push_back(chunk->createMesh(rebuilds[i].lod));
+    if (chunk->meshStats.acmrBefore > 0.f) {
+      meshAcmr.acmrBefore += chunk->meshStats.acmrBefore;
+      meshAcmr.acmrAfter += chunk->meshStats.acmrAfter;
+      meshAcmrCount++;
+    }
+  }
+}
+
+void FirstApp::unloadChunk(std::unique_ptr<Chunk> chunk, int frameIndex) {
+  glm::ivec3 coord = chunk->origin / Chunk::SIZE;
+  std::vector<uint8_t> types = chunk->getVoxelTypes();
+  // the cache may drop it later, edits have to reach the disk
+  if (chunk->modified) worldStorage.saveChunk(coord, types);
+  coldChunks.store(coord, types);
+  retiredChunks[frameIndex].push_back(std::move(chunk));
+}
+
+glm::vec4 FirstApp::streamedRegion() const {
+  return glm::vec4{
+      (streamCenter.x - VIEW_DISTANCE) * Chunk::SIZE,
+      (streamCenter.z - VIEW_DISTANCE) * Chunk::SIZE,
+      (streamCenter.x + VIEW_DISTANCE + 1) * Chunk::SIZE,
+      (streamCenter.z + VIEW_DISTANCE + 1) * Chunk::SIZE};
+}
+
+void FirstApp::saveChunks() {
+  chunkRegistry.forEach([&](const ChunkRegistry::Entry &entry) {
+    if (!entry.chunk->modified) return;
+    worldStorage.saveChunk(entry.coord, entry.chunk->getVoxelTypes());
+    entry.chunk->modified = false;
+  });
+  worldStorage.flush();
+}
+
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "defines.hpp"
+#include "zx_command_recorder.hpp"
 #include "zx_descriptors.hpp"
 #include "zx_device.hpp"
-#include "zx_game_object.hpp"
+#include "zx_scene.hpp"
+#include "chunk_cache.hpp"
+#include "chunk_registry.hpp"
+#include "region_file.hpp"
 #include "zx_renderer.hpp"
+#include "zx_bindless_set.hpp"
+#include "zx_texture_loader.hpp"
 #include "zx_window.hpp"
 #include "zx_utils.hpp"
 
@@ -12,12 +18,29 @@
 #include <vector>
 
 namespace zx {
+class VoxelRenderSystem;
+
 class FirstApp {
  public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
+  // chunks kept loaded around the camera chunk along x and z
+  static constexpr int VIEW_DISTANCE = 4;
+  static constexpr int MAX_CHUNK_LOADS_PER_FRAME = 4;
+  // meshes built per frame, new chunks and LOD changes share it
+  static constexpr int MAX_CHUNK_MESHES_PER_FRAME = 4;
+  static constexpr size_t COLD_CHUNK_BUDGET = 32 * 1024 * 1024;
+  // entries of the per frame object buffer, one per transform
+  static constexpr uint32_t MAX_OBJECTS = 16384;
+  // threads recording secondary command buffers, the main thread included
+  static constexpr uint32_t RECORDING_THREADS = 4;
 
-  FirstApp();
+  // framesInFlight trades latency for throughput, see ZxSwapChain::MAX_FRAMES_IN_FLIGHT
+  // chunkMesher meshes every chunk, see ChunkMesher::build
+  explicit FirstApp(
+      int framesInFlight = ZxSwapChain::DEFAULT_FRAMES_IN_FLIGHT,
+      FramePacing framePacing = FramePacing::throughput,
+      Chunk::Mesher chunkMesher = Chunk::Mesher::blocky);
   ~FirstApp();
 
   FirstApp(const FirstApp &) = delete;
@@ -26,14 +49,41 @@ class FirstApp {
   void run();
 
  private:
-  void loadGameObjects();
+  // loads missing chunks near the camera and unloads the ones that went out of range
+  void streamChunks(glm::vec3 cameraPosition, int frameIndex);
+  std::unique_ptr<Chunk> loadChunk(glm::ivec3 coord);
+  // meshes every chunk whose selected LOD differs from its resident mesh, or whose voxels
+  // changed, nearest first. Chunks only ever keep the LOD they are drawn at
+  void updateChunkMeshes(
+      glm::vec3 cameraPosition, int frameIndex, const VoxelRenderSystem &voxelRenderSystem);
+  void unloadChunk(std::unique_ptr<Chunk> chunk, int frameIndex);
+  // xz rectangle covered by the chunks around the camera
+  glm::vec4 streamedRegion() const;
+  void saveChunks();
 
   ZxWindow zxWindow{WIDTH, HEIGHT, "Zenix"};
   ZxDevice zxDevice{zxWindow};
-  ZxRenderer zxRenderer{zxWindow, zxDevice};
+  ZxRenderer zxRenderer;
+  ZxCommandRecorder commandRecorder;
+  ZxBindlessSet bindlessSet{zxDevice};
+  // after bindlessSet, its textures have to go first
+  ZxTextureLoader textureLoader{zxDevice, bindlessSet};
 
   // note: order of declarations matters
   std::unique_ptr<ZxDescriptorPool> globalPool{};
-  ZxGameObject::Map gameObjects;
+  RegionStorage worldStorage{"../world"};
+  ZxScene scene;
+  ChunkRegistry chunkRegistry{};
+  ChunkCache coldChunks{COLD_CHUNK_BUDGET};
+  glm::ivec3 streamCenter{};
+  Chunk::Mesher chunkMesher;
+  // summed ACMR of the chunk meshes rebuilt since the last stats line
+  MeshOptimizer::Stats meshAcmr{};
+  int meshAcmrCount = 0;
+  // unloaded chunks whose buffers may still be used by the frame that last drew them,
+  // freed once their frame index comes around again
+  std::vector<std::vector<std::unique_ptr<Chunk>>> retiredChunks;
+  // meshes replaced by a rebuild at another LOD, freed the same way
+  std::vector<std::vector<Chunk::Mesh>> retiredMeshes;
 };
 }
@@ -20,7 +20,7 @@ class KeyboardMovementController {
     int lookDown = GLFW_KEY_UP;
   };
 
-  void moveInPlaneXZ(GLFWwindow* window, float dt, ZxGameObject& gameObject);
+  void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
   KeyMappings keys{};
   float moveSpeed{3.f*3.f};
@@ -1,13 +1,45 @@
 #include "first_app.hpp"
+#include "texture_container.hpp"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 int main(int argc, char **argv) {
-  zx::FirstApp app{};
+  int framesInFlight = zx::ZxSwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+  zx::FramePacing framePacing = zx::FramePacing::throughput;
+  zx::Chunk::Mesher chunkMesher = zx::Chunk::Mesher::blocky;
+  std::vector<std::string> convertTextures;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+      framesInFlight = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+      framePacing = zx::FramePacing::lowLatency;
+    } else if (std::strcmp(argv[i], "--mesher") == 0 && i + 1 < argc) {
+      // blocky or surface-nets
+      chunkMesher = std::strcmp(argv[++i], "surface-nets") == 0 ? zx::Chunk::Mesher::surfaceNets
+                                                                 : zx::Chunk::Mesher::blocky;
+    } else if (std::strcmp(argv[i], "--convert-texture") == 0 && i + 1 < argc) {
+      convertTextures.push_back(argv[++i]);
+    }
+  }
+
+  // offline conversion, writes image + TextureContainer::EXTENSION next to each image and
+  // exits without opening a window
+  if (!convertTextures.empty()) {
+    bool converted = true;
+    for (const auto &image : convertTextures) {
+      converted = zx::TextureContainer::convert(image, image + zx::TextureContainer::EXTENSION) &&
+                  converted;
+    }
+    return converted ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
   try {
+    zx::FirstApp app{framesInFlight, framePacing, chunkMesher};
     app.run();
   } catch (const std::exception &e) {
     std::cerr << e.what() << '\n';
@@ -0,0 +1,160 @@
+#include "mesh_cache.hpp"
+#include "zx_utils.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace zx {
+
+namespace {
+constexpr char MAGIC[4] = {'Z', 'X', 'M', 'S'};
+
+// FNV-1a, only used to tell whether a source file changed
+uint64_t hashBytes(const uint8_t *data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+}  // namespace
+
+bool MeshCache::statSource(const std::string &sourcePath, uint64_t &size, int64_t &time) {
+  std::error_code error;
+  size = std::filesystem::file_size(sourcePath, error);
+  if (error) return false;
+  auto writeTime = std::filesystem::last_write_time(sourcePath, error);
+  if (error) return false;
+  time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+  return true;
+}
+
+bool MeshCache::hashSource(const std::string &sourcePath, uint64_t &hash) {
+  ZxMappedFile source;
+  if (!source.open(sourcePath)) return false;
+  hash = hashBytes(source.data(), source.size());
+  return true;
+}
+
+bool MeshCache::open(const std::string &sourcePath, const std::string &cachePath) {
+  header = nullptr;
+  if (!file.open(cachePath) || file.size() < sizeof(Header)) return false;
+
+  const auto *candidate = reinterpret_cast<const Header *>(file.data());
+  // models upload at the width indexTypeFor picks, a cache stored at another one reads wrong
+  uint32_t indexSize = ZxModel::indexTypeFor(candidate->vertexCount) == VK_INDEX_TYPE_UINT16
+                           ? sizeof(uint16_t)
+                           : sizeof(uint32_t);
+  uint64_t expectedSize = sizeof(Header) +
+                          static_cast<uint64_t>(candidate->vertexCount) * sizeof(ZxModel::Vertex) +
+                          static_cast<uint64_t>(candidate->meshletCount) * sizeof(Meshlet) +
+                          static_cast<uint64_t>(candidate->indexCount) * candidate->indexSize;
+  if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      candidate->version != VERSION || candidate->vertexStride != sizeof(ZxModel::Vertex) ||
+      candidate->indexSize != indexSize ||
+      file.size() != expectedSize) {
+    file.close();
+    return false;
+  }
+
+  uint64_t sourceSize = 0;
+  int64_t sourceTime = 0;
+  if (!statSource(sourcePath, sourceSize, sourceTime)) {
+    // the source is gone, the cache is all there is
+    header = candidate;
+    return true;
+  }
+  if (sourceSize != candidate->sourceSize) {
+    file.close();
+    return false;
+  }
+  if (sourceTime != candidate->sourceTime) {
+    // touched, possibly by a checkout, only the contents decide
+    uint64_t sourceHash = 0;
+    if (!hashSource(sourcePath, sourceHash) || sourceHash != candidate->sourceHash) {
+      file.close();
+      return false;
+    }
+  }
+
+  header = candidate;
+  return true;
+}
+
+void MeshCache::write(
+    const std::string &sourcePath,
+    const std::string &cachePath,
+    const ZxModel::Builder &builder) {
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.vertexStride = sizeof(ZxModel::Vertex);
+  header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+  header.indexCount = static_cast<uint32_t>(builder.indices.size());
+  header.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+  bool shortIndices = ZxModel::indexTypeFor(header.vertexCount) == VK_INDEX_TYPE_UINT16;
+  header.indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+  if (!statSource(sourcePath, header.sourceSize, header.sourceTime) ||
+      !hashSource(sourcePath, header.sourceHash)) {
+    return;
+  }
+
+  // written next to the old file and renamed over it, a reader never maps a partial cache
+  std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream out{tempPath, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(
+        reinterpret_cast<const char *>(builder.vertices.data()),
+        static_cast<std::streamsize>(builder.vertices.size() * sizeof(ZxModel::Vertex)));
+    out.write(
+        reinterpret_cast<const char *>(builder.meshlets.data()),
+        static_cast<std::streamsize>(builder.meshlets.size() * sizeof(Meshlet)));
+    if (shortIndices) {
+      std::vector<uint16_t> shortData(builder.indices.begin(), builder.indices.end());
+      out.write(
+          reinterpret_cast<const char *>(shortData.data()),
+          static_cast<std::streamsize>(shortData.size() * sizeof(uint16_t)));
+    } else {
+      out.write(
+          reinterpret_cast<const char *>(builder.indices.data()),
+          static_cast<std::streamsize>(builder.indices.size() * sizeof(uint32_t)));
+    }
+    if (!out) {
+      info("Failed to write mesh cache: " + cachePath, 0);
+      return;
+    }
+  }
+  if (!replaceFile(tempPath, cachePath)) {
+    info("Failed to replace mesh cache: " + cachePath, 0);
+  }
+}
+
+const ZxModel::Vertex *MeshCache::vertices() const {
+  return reinterpret_cast<const ZxModel::Vertex *>(file.data() + sizeof(Header));
+}
+
+uint32_t MeshCache::vertexCount() const { return header->vertexCount; }
+
+const Meshlet *MeshCache::meshlets() const {
+  return reinterpret_cast<const Meshlet *>(
+      file.data() + sizeof(Header) + header->vertexCount * sizeof(ZxModel::Vertex));
+}
+
+uint32_t MeshCache::meshletCount() const { return header->meshletCount; }
+
+// after the meshlets, which keeps both arrays 4 byte aligned whatever the index size
+const void *MeshCache::indices() const {
+  return file.data() + sizeof(Header) + header->vertexCount * sizeof(ZxModel::Vertex) +
+         header->meshletCount * sizeof(Meshlet);
+}
+
+uint32_t MeshCache::indexCount() const { return header->indexCount; }
+
+VkIndexType MeshCache::indexType() const {
+  return header->indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_mapped_file.hpp"
+#include "zx_model.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace zx {
+
+// Binary copy of a mesh imported from a text format: a fixed header followed by the raw
+// vertex, meshlet and index arrays, laid out exactly as they are uploaded. A cache file is mapped
+// and its arrays are copied straight into the staging buffers, so loading it costs a
+// memcpy instead of parsing and deduplicating the source again.
+//
+// The header records the size, modification time and hash of the source it was built
+// from. A cache whose size and time still match is trusted as is; otherwise the source
+// is hashed and the cache is only used if the contents are unchanged.
+class MeshCache {
+ public:
+  static constexpr const char *EXTENSION = ".zxmesh";
+  // 2: meshes are stored after MeshOptimizer
+  // 3: indices are stored 16 bit when the vertex count allows it
+  // 4: meshlets are stored between the vertices and the indices
+  static constexpr uint32_t VERSION = 4;
+
+  // maps cachePath and checks it against the source file, false if it is missing or stale
+  bool open(const std::string &sourcePath, const std::string &cachePath);
+  // writes the builder's mesh, failures only cost a slower load next time
+  static void write(
+      const std::string &sourcePath,
+      const std::string &cachePath,
+      const ZxModel::Builder &builder);
+
+  const ZxModel::Vertex *vertices() const;
+  uint32_t vertexCount() const;
+  // 16 or 32 bit, as reported by indexType
+  const void *indices() const;
+  uint32_t indexCount() const;
+  VkIndexType indexType() const;
+  const Meshlet *meshlets() const;
+  uint32_t meshletCount() const;
+
+ private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    // sizeof(ZxModel::Vertex) when written, catches vertex layout changes
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    // bytes per index, 2 or 4
+    uint32_t indexSize;
+    uint32_t meshletCount;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+  };
+
+  static bool statSource(const std::string &sourcePath, uint64_t &size, int64_t &time);
+  static bool hashSource(const std::string &sourcePath, uint64_t &hash);
+
+  ZxMappedFile file;
+  const Header *header = nullptr;
+};
+}
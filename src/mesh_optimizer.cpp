@@ -0,0 +1,275 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace zx {
+
+void MeshOptimizer::optimizeVertexCache(
+    std::vector<uint32_t> &indices,
+    size_t vertexCount,
+    uint32_t cacheSize,
+    std::vector<uint32_t> *clusters) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3!");
+  const size_t triangleCount = indices.size() / 3;
+  if (clusters) clusters->clear();
+  if (triangleCount == 0) return;
+
+  // triangles around every vertex, as one flat array with per vertex offsets
+  std::vector<uint32_t> live(vertexCount, 0);
+  for (uint32_t index : indices) live[index]++;
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+      adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  std::vector<uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnd;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+
+  uint32_t time = cacheSize + 1;
+  size_t cursor = 0;
+  size_t clusterStart = 0;
+  if (clusters) clusters->push_back(0);
+
+  // next vertex with triangles left once the fan ran into a dead end, -1 when done
+  auto skipDeadEnd = [&]() -> int64_t {
+    while (!deadEnd.empty()) {
+      uint32_t v = deadEnd.back();
+      deadEnd.pop_back();
+      if (live[v] > 0) return v;
+    }
+    for (; cursor < vertexCount; cursor++) {
+      if (live[cursor] > 0) return static_cast<int64_t>(cursor);
+    }
+    return -1;
+  };
+
+  int64_t fan = skipDeadEnd();
+  while (fan >= 0) {
+    candidates.clear();
+    for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+      uint32_t t = adjacency[a];
+      if (emitted[t]) continue;
+      for (int c = 0; c < 3; c++) {
+        uint32_t v = indices[t * 3 + c];
+        output.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cacheTime[v] > cacheSize) {
+          cacheTime[v] = time++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // the candidate that is still in the cache after its remaining triangles are emitted,
+    // preferring the one that entered it earliest
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0) continue;
+      int64_t priority = 0;
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+        priority = time - cacheTime[v];
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        best = v;
+      }
+    }
+
+    if (best < 0) {
+      best = skipDeadEnd();
+      // the cache is effectively cold after a jump, a natural place to cut a cluster
+      size_t emittedTriangles = output.size() / 3;
+      if (clusters && best >= 0 && emittedTriangles - clusterStart >= MIN_CLUSTER_TRIANGLES) {
+        clusterStart = emittedTriangles;
+        clusters->push_back(static_cast<uint32_t>(clusterStart));
+      }
+    }
+    fan = best;
+  }
+
+  assert(output.size() == indices.size() && "Tipsify lost triangles!");
+  indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(
+    std::vector<uint32_t> &indices,
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &clusters) {
+  const size_t triangleCount = indices.size() / 3;
+  if (clusters.size() < 2) return;
+
+  glm::vec3 meshCentre{0.f};
+  for (uint32_t index : indices) meshCentre += positions[index];
+  meshCentre /= static_cast<float>(indices.size());
+
+  // clusters whose surface faces away from the mesh centre are drawn first
+  std::vector<float> sortKeys(clusters.size());
+  for (size_t c = 0; c < clusters.size(); c++) {
+    size_t first = clusters[c];
+    size_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+    glm::vec3 centre{0.f};
+    glm::vec3 normal{0.f};
+    for (size_t t = first; t < last; t++) {
+      const glm::vec3 &p0 = positions[indices[t * 3 + 0]];
+      const glm::vec3 &p1 = positions[indices[t * 3 + 1]];
+      const glm::vec3 &p2 = positions[indices[t * 3 + 2]];
+      centre += p0 + p1 + p2;
+      // area weighted
+      normal += glm::cross(p1 - p0, p2 - p0);
+    }
+    centre /= static_cast<float>((last - first) * 3);
+    float length = glm::length(normal);
+    sortKeys[c] = length > 0.f ? glm::dot(centre - meshCentre, normal / length) : 0.f;
+  }
+
+  std::vector<uint32_t> order(clusters.size());
+  std::iota(order.begin(), order.end(), 0u);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (uint32_t c : order) {
+    size_t first = clusters[c];
+    size_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+    sorted.insert(sorted.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+  }
+  indices.swap(sorted);
+}
+
+std::vector<uint32_t> MeshOptimizer::fetchRemap(std::vector<uint32_t> &indices, size_t vertexCount) {
+  std::vector<uint32_t> remap(vertexCount, UNUSED);
+  uint32_t next = 0;
+  for (uint32_t &index : indices) {
+    if (remap[index] == UNUSED) remap[index] = next++;
+    index = remap[index];
+  }
+  return remap;
+}
+
+std::vector<Meshlet> MeshOptimizer::buildMeshlets(
+    const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3!");
+  const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  std::vector<Meshlet> meshlets;
+
+  // a vertex belongs to the current meshlet when its stamp equals the meshlet number
+  std::vector<uint32_t> stamp(positions.size(), UNUSED);
+  uint32_t meshletVertices = 0;
+  uint32_t firstTriangle = 0;
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    uint32_t current = static_cast<uint32_t>(meshlets.size());
+    uint32_t newVertices = 0;
+    for (int c = 0; c < 3; c++) {
+      uint32_t v = indices[t * 3 + c];
+      // a triangle may repeat a vertex, count it once
+      bool seen = stamp[v] == current;
+      for (int p = 0; p < c && !seen; p++) seen = indices[t * 3 + p] == v;
+      if (!seen) newVertices++;
+    }
+
+    if (meshletVertices + newVertices > MAX_MESHLET_VERTICES ||
+        t - firstTriangle == MAX_MESHLET_TRIANGLES) {
+      meshlets.push_back(meshletBounds(indices, positions, firstTriangle, t - firstTriangle));
+      firstTriangle = t;
+      meshletVertices = 0;
+      current++;
+    }
+    for (int c = 0; c < 3; c++) {
+      uint32_t v = indices[t * 3 + c];
+      if (stamp[v] != current) {
+        stamp[v] = current;
+        meshletVertices++;
+      }
+    }
+  }
+  if (firstTriangle < triangleCount) {
+    meshlets.push_back(
+        meshletBounds(indices, positions, firstTriangle, triangleCount - firstTriangle));
+  }
+  return meshlets;
+}
+
+Meshlet MeshOptimizer::meshletBounds(
+    const std::vector<uint32_t> &indices,
+    const std::vector<glm::vec3> &positions,
+    uint32_t firstTriangle,
+    uint32_t triangleCount) {
+  Meshlet meshlet{};
+  meshlet.firstIndex = firstTriangle * 3;
+  meshlet.indexCount = triangleCount * 3;
+
+  // sphere around the box centre, loose but cheap and never misses a vertex
+  glm::vec3 lo = positions[indices[meshlet.firstIndex]];
+  glm::vec3 hi = lo;
+  for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+    lo = glm::min(lo, positions[indices[i]]);
+    hi = glm::max(hi, positions[indices[i]]);
+  }
+  meshlet.center = (lo + hi) * 0.5f;
+  for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+    meshlet.radius = std::max(meshlet.radius, glm::length(positions[indices[i]] - meshlet.center));
+  }
+
+  // cone around the average face normal, wide enough for the normal furthest from it;
+  // degenerate triangles have no normal and are left out
+  std::vector<glm::vec3> normals;
+  normals.reserve(triangleCount);
+  glm::vec3 axis{0.f};
+  for (uint32_t t = firstTriangle; t < firstTriangle + triangleCount; t++) {
+    const glm::vec3 &p0 = positions[indices[t * 3 + 0]];
+    const glm::vec3 &p1 = positions[indices[t * 3 + 1]];
+    const glm::vec3 &p2 = positions[indices[t * 3 + 2]];
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(normal);
+    if (length <= 0.f) continue;
+    normals.push_back(normal / length);
+    axis += normals.back();
+  }
+  float axisLength = glm::length(axis);
+  if (normals.empty() || axisLength <= 0.f) return meshlet;
+  meshlet.coneAxis = axis / axisLength;
+
+  float minDot = 1.f;
+  for (const glm::vec3 &normal : normals) {
+    minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+  }
+  // a cone of half angle 90 degrees or more always has a front facing triangle
+  if (minDot <= 0.f) return meshlet;
+  meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+  return meshlet;
+}
+
+float MeshOptimizer::acmr(const std::vector<uint32_t> &indices, uint32_t cacheSize) {
+  if (indices.size() < 3) return 0.f;
+
+  // FIFO cache, a vertex is in it while fewer than cacheSize misses happened since it entered
+  uint32_t maxIndex = *std::max_element(indices.begin(), indices.end());
+  std::vector<uint64_t> enteredAt(static_cast<size_t>(maxIndex) + 1, 0);
+  uint64_t misses = 0;
+  for (uint32_t index : indices) {
+    if (enteredAt[index] == 0 || misses - enteredAt[index] >= cacheSize) {
+      misses++;
+      enteredAt[index] = misses;
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "defines.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zx {
+
+// A run of consecutive triangles of an index buffer with bounds for culling it as a whole,
+// laid out as read by the culling shader (std430).
+struct Meshlet {
+  glm::vec3 center{};
+  float radius = 0.f;
+  // the meshlet faces away from a viewer at eye when
+  // dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius;
+  // coneCutoff is 1 when the normals spread too far for that to ever hold
+  glm::vec3 coneAxis{};
+  float coneCutoff = 1.f;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  uint32_t padding[2]{};
+};
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match its std430 layout");
+
+// Reorders indexed triangle lists for the GPU, in place:
+//  - triangles for post transform vertex cache hits, using Tipsify (Sander, Nehab and
+//    Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"),
+//  - optionally the clusters Tipsify leaves behind, outward facing ones first, so they
+//    tend to occlude the rest of the mesh,
+//  - vertices into the order the triangles first use them, for fetch locality.
+// Optimized triangles can then be split into meshlets, in their drawing order.
+// Results are measured as ACMR, vertex shader invocations per triangle with a FIFO cache.
+// Imported models and surface nets chunk meshes go through it. Blocky chunks skip it: LOD 0
+// shares the corners of each voxel and emits voxel by voxel, already at 0.67, and coarser LODs
+// are separate quads at 2.0; neither improves (see benchmarks/chunk_mesher_bench.cpp).
+class MeshOptimizer {
+ public:
+  static constexpr uint32_t CACHE_SIZE = 16;
+  // clusters shorter than this are merged into the next one, too small to be worth sorting
+  static constexpr uint32_t MIN_CLUSTER_TRIANGLES = 64;
+  // small enough for a meshlet to be culled at a useful granularity, and within the limits
+  // mesh shading hardware commonly prefers
+  static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+  static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+  struct Stats {
+    float acmrBefore = 0.f;
+    float acmrAfter = 0.f;
+  };
+
+  template <typename Vertex>
+  static Stats optimize(
+      std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, bool sortForOverdraw) {
+    Stats stats{};
+    if (indices.size() < 3) return stats;
+
+    stats.acmrBefore = acmr(indices);
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertices.size(), CACHE_SIZE, sortForOverdraw ? &clusters : nullptr);
+    if (sortForOverdraw) {
+      std::vector<glm::vec3> positions(vertices.size());
+      for (size_t i = 0; i < vertices.size(); i++) positions[i] = vertices[i].position;
+      optimizeOverdraw(indices, positions, clusters);
+    }
+    optimizeVertexFetch(vertices, indices);
+    stats.acmrAfter = acmr(indices);
+    return stats;
+  }
+
+  // clusters, when given, receives the first triangle of every cluster
+  static void optimizeVertexCache(
+      std::vector<uint32_t> &indices,
+      size_t vertexCount,
+      uint32_t cacheSize = CACHE_SIZE,
+      std::vector<uint32_t> *clusters = nullptr);
+  static void optimizeOverdraw(
+      std::vector<uint32_t> &indices,
+      const std::vector<glm::vec3> &positions,
+      const std::vector<uint32_t> &clusters);
+
+  // drops unreferenced vertices
+  template <typename Vertex>
+  static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+    std::vector<uint32_t> remap = fetchRemap(indices, vertices.size());
+    std::vector<Vertex> reordered(vertices.size());
+    size_t used = 0;
+    for (size_t v = 0; v < vertices.size(); v++) {
+      if (remap[v] == UNUSED) continue;
+      reordered[remap[v]] = vertices[v];
+      used++;
+    }
+    reordered.resize(used);
+    vertices.swap(reordered);
+  }
+
+  // cuts the triangles into meshlets without reordering them, so the index buffer and its
+  // cache and overdraw order stay as they are
+  template <typename Vertex>
+  static std::vector<Meshlet> buildMeshlets(
+      const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) positions[i] = vertices[i].position;
+    return buildMeshlets(indices, positions);
+  }
+  static std::vector<Meshlet> buildMeshlets(
+      const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions);
+
+  static float acmr(const std::vector<uint32_t> &indices, uint32_t cacheSize = CACHE_SIZE);
+
+ private:
+  static constexpr uint32_t UNUSED = UINT32_MAX;
+
+  // new position of every vertex in first use order, UNUSED if no triangle uses it;
+  // rewrites indices to match
+  static std::vector<uint32_t> fetchRemap(std::vector<uint32_t> &indices, size_t vertexCount);
+  static Meshlet meshletBounds(
+      const std::vector<uint32_t> &indices,
+      const std::vector<glm::vec3> &positions,
+      uint32_t firstTriangle,
+      uint32_t triangleCount);
+};
+}
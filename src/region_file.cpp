@@ -0,0 +1,269 @@
+#include "region_file.hpp"
+
+#include "chunk_codec.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace zx {
+
+namespace {
+constexpr char MAGIC[4] = {'Z', 'X', 'R', 'G'};
+
+int floorDiv(int a, int b) { return (a >= 0 ? a : a - b + 1) / b; }
+
+uint64_t packRegion(glm::ivec2 region) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(region.x)) << 32) |
+         static_cast<uint32_t>(region.y);
+}
+
+// 21 bits per axis, plenty for chunk coordinates
+uint64_t packChunk(glm::ivec3 coord) {
+  constexpr uint64_t mask = (1ull << 21) - 1;
+  return ((static_cast<uint64_t>(coord.x) & mask) << 42) |
+         ((static_cast<uint64_t>(coord.y) & mask) << 21) | (static_cast<uint64_t>(coord.z) & mask);
+}
+
+glm::ivec3 unpackChunk(uint64_t key) {
+  auto axis = [](uint64_t bits) {
+    bits &= (1ull << 21) - 1;
+    return static_cast<int>(bits & (1ull << 20) ? bits | ~((1ull << 21) - 1) : bits);
+  };
+  return glm::ivec3{axis(key >> 42), axis(key >> 21), axis(key)};
+}
+
+void locate(glm::ivec3 coord, glm::ivec2 &region, glm::ivec3 &local) {
+  region = glm::ivec2{
+      floorDiv(coord.x, RegionFile::COLUMNS),
+      floorDiv(coord.z, RegionFile::COLUMNS)};
+  local = glm::ivec3{
+      coord.x - region.x * RegionFile::COLUMNS,
+      coord.y,
+      coord.z - region.y * RegionFile::COLUMNS};
+}
+
+uint64_t tell(std::FILE *file) {
+#ifdef _WIN32
+  return static_cast<uint64_t>(_ftelli64(file));
+#else
+  return static_cast<uint64_t>(ftello(file));
+#endif
+}
+
+// flushes the stdio buffer and makes the OS push the data to the disk
+bool sync(std::FILE *file) {
+  if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+}  // namespace
+
+RegionFile::RegionFile(const std::string &filepath) : filepath{filepath} {
+  bool exists = std::filesystem::exists(filepath);
+  file = std::fopen(filepath.c_str(), exists ? "r+b" : "w+b");
+  if (!file) {
+    info("Failed to open region file: " + filepath, 0);
+    return;
+  }
+
+  if (exists) {
+    Header header{};
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION;
+    std::fseek(file, 0, SEEK_END);
+    // the whole entry table has to be there before anything is mapped and read from it
+    if (!valid || tell(file) < entryOffset(ENTRY_COUNT)) {
+      info("Invalid region file: " + filepath, 0);
+      corrupt = true;
+      std::fclose(file);
+      file = nullptr;
+      return;
+    }
+  } else {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    std::vector<Entry> table(ENTRY_COUNT, Entry{0, 0, 0});
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1 ||
+        std::fwrite(table.data(), sizeof(Entry), table.size(), file) != table.size() || !sync(file)) {
+      info("Failed to create region file: " + filepath, 0);
+      std::fclose(file);
+      file = nullptr;
+      return;
+    }
+  }
+
+  std::fseek(file, 0, SEEK_END);
+  fileEnd = tell(file);
+}
+
+RegionFile::~RegionFile() {
+  mapping.close();
+  if (file) std::fclose(file);
+}
+
+void RegionFile::seek(uint64_t offset) {
+#ifdef _WIN32
+  _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET);
+#else
+  fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+bool RegionFile::read(glm::ivec3 local, std::vector<uint8_t> &payload) {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (!file) return false;
+
+  // the file only grows, remap once it outgrew the current mapping
+  if (mapping.size() < fileEnd && !mapping.open(filepath)) return false;
+  if (mapping.size() < entryOffset(ENTRY_COUNT)) return false;
+
+  Entry entry;
+  std::memcpy(&entry, mapping.data() + entryOffset(entryIndex(local)), sizeof(Entry));
+  // written so a corrupt offset near UINT64_MAX can't wrap around
+  if (entry.size == 0 || entry.offset > mapping.size() || entry.size > mapping.size() - entry.offset) {
+    return false;
+  }
+
+  payload.assign(mapping.data() + entry.offset, mapping.data() + entry.offset + entry.size);
+  return true;
+}
+
+bool RegionFile::write(glm::ivec3 local, const std::vector<uint8_t> &payload) {
+  // only one writer at a time, readers just wait for the table entry update below
+  std::lock_guard<std::mutex> writeLock{writeMutex};
+  if (!file) return false;
+
+  // fileEnd only changes under writeMutex, readers never see the unreferenced tail
+  Entry entry{fileEnd, static_cast<uint32_t>(payload.size()), 0};
+  seek(entry.offset);
+  // payload has to be on disk before the table points at it
+  bool written = std::fwrite(payload.data(), 1, payload.size(), file) == payload.size() && sync(file);
+  std::fseek(file, 0, SEEK_END);
+  uint64_t end = tell(file);
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    fileEnd = end;
+    if (!written) return false;
+    seek(entryOffset(entryIndex(local)));
+    if (std::fwrite(&entry, sizeof(entry), 1, file) != 1 || std::fflush(file) != 0) return false;
+  }
+  return sync(file);
+}
+
+RegionStorage::RegionStorage(const std::string &directory) : directory{directory} {
+  std::filesystem::create_directories(directory);
+  writer = std::thread([this] { writerLoop(); });
+}
+
+RegionStorage::~RegionStorage() {
+  {
+    std::lock_guard<std::mutex> lock{queueMutex};
+    stopping = true;
+  }
+  queueCondition.notify_one();
+  writer.join();
+}
+
+RegionFile &RegionStorage::getRegion(glm::ivec2 region) {
+  std::lock_guard<std::mutex> lock{regionsMutex};
+  auto &regionFile = regions[packRegion(region)];
+  if (!regionFile) {
+    std::string filepath = directory + "/r." + std::to_string(region.x) + "." +
+                           std::to_string(region.y) + ".zxr";
+    regionFile = std::make_unique<RegionFile>(filepath);
+    if (regionFile->isCorrupt()) {
+      // move the corrupt file out of the way, its chunks get regenerated and saved to a new one.
+      // A file that merely failed to open is left alone, the region just stays closed
+      std::error_code error;
+      std::filesystem::rename(filepath, filepath + ".corrupt", error);
+      if (!error) regionFile = std::make_unique<RegionFile>(filepath);
+    }
+  }
+  return *regionFile;
+}
+
+bool RegionStorage::loadChunk(glm::ivec3 coord, std::vector<uint8_t> &types) {
+  if (coord.y < 0 || coord.y >= RegionFile::COLUMN_HEIGHT) return false;
+
+  {
+    // a save still waiting for the writer is newer than what is on disk
+    std::lock_guard<std::mutex> lock{queueMutex};
+    uint64_t key = packChunk(coord);
+    auto it = pending.find(key);
+    if (it != pending.end()) {
+      types = it->second;
+      return true;
+    }
+    if (writing && inFlight.key() == key) {
+      types = inFlight.mapped();
+      return true;
+    }
+  }
+
+  glm::ivec2 region;
+  glm::ivec3 local;
+  locate(coord, region, local);
+
+  std::vector<uint8_t> payload;
+  if (!getRegion(region).read(local, payload)) return false;
+  return ChunkCodec::decode(payload.data(), payload.size(), types);
+}
+
+void RegionStorage::saveChunk(glm::ivec3 coord, std::vector<uint8_t> types) {
+  if (coord.y < 0 || coord.y >= RegionFile::COLUMN_HEIGHT) {
+    info("Chunk outside of region height, not saved", 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{queueMutex};
+    pending[packChunk(coord)] = std::move(types);
+  }
+  queueCondition.notify_one();
+}
+
+void RegionStorage::flush() {
+  std::unique_lock<std::mutex> lock{queueMutex};
+  idleCondition.wait(lock, [this] { return pending.empty() && !writing; });
+}
+
+void RegionStorage::writerLoop() {
+  std::unique_lock<std::mutex> lock{queueMutex};
+  while (true) {
+    queueCondition.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (pending.empty()) break;
+
+    inFlight = pending.extract(pending.begin());
+    writing = true;
+    lock.unlock();
+
+    // inFlight is only modified by this thread, readers look at it under the lock
+    glm::ivec3 coord = unpackChunk(inFlight.key());
+    glm::ivec2 region;
+    glm::ivec3 local;
+    locate(coord, region, local);
+    std::vector<uint8_t> payload = ChunkCodec::encode(inFlight.mapped().data(), inFlight.mapped().size());
+    if (!getRegion(region).write(local, payload)) {
+      info("Failed to save chunk to its region file", 0);
+    }
+
+    lock.lock();
+    writing = false;
+    inFlight = {};
+    idleCondition.notify_all();
+  }
+}
+
+}
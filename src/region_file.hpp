@@ -0,0 +1,117 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_mapped_file.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace zx {
+
+// One file holding COLUMNS x COLUMNS chunk columns of COLUMN_HEIGHT chunks each.
+// The file starts with a header and a fixed table of (offset, size) entries, one per chunk,
+// followed by compressed payloads. A payload is never overwritten in place: a new version is
+// appended and only then is its table entry updated, so a crash mid write leaves the old
+// version readable. Reads go through a memory mapping of the file.
+class RegionFile {
+ public:
+  static constexpr int COLUMNS = 32;
+  static constexpr int COLUMN_HEIGHT = 8;
+  static constexpr int ENTRY_COUNT = COLUMNS * COLUMNS * COLUMN_HEIGHT;
+  static constexpr uint32_t VERSION = 1;
+
+  // opening never throws, a file that can't be opened or fails validation leaves the region
+  // closed and every read misses so the chunks are regenerated. Only a failed validation marks
+  // the file corrupt
+  explicit RegionFile(const std::string &filepath);
+  ~RegionFile();
+
+  RegionFile(const RegionFile &) = delete;
+  RegionFile &operator=(const RegionFile &) = delete;
+
+  bool isOpen() const { return file != nullptr; }
+  // the header or entry table is invalid, as opposed to the file failing to open at all
+  bool isCorrupt() const { return corrupt; }
+
+  // local is the chunk coordinate inside the region, returns false if the chunk was never written
+  bool read(glm::ivec3 local, std::vector<uint8_t> &payload);
+  // returns false if the payload or its table entry could not be written and synced
+  bool write(glm::ivec3 local, const std::vector<uint8_t> &payload);
+
+ private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+  };
+
+  struct Entry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t reserved;
+  };
+
+  static int entryIndex(glm::ivec3 local) {
+    return (local.y * COLUMNS + local.z) * COLUMNS + local.x;
+  }
+  static uint64_t entryOffset(int index) { return sizeof(Header) + index * sizeof(Entry); }
+
+  void seek(uint64_t offset);
+
+  std::string filepath;
+  std::FILE *file = nullptr;
+  uint64_t fileEnd = 0;
+  bool corrupt = false;
+  ZxMappedFile mapping{};
+  // guards the mapping, fileEnd and the entry table, held by write only while it updates an entry
+  std::mutex mutex;
+  // serializes writes, the payload is written and synced under this lock alone
+  std::mutex writeMutex;
+};
+
+// Chunk persistence over a directory of region files. Saves are queued and written by a
+// background thread, a chunk saved twice before the writer gets to it is only written once.
+class RegionStorage {
+ public:
+  explicit RegionStorage(const std::string &directory);
+  ~RegionStorage();
+
+  RegionStorage(const RegionStorage &) = delete;
+  RegionStorage &operator=(const RegionStorage &) = delete;
+
+  // coord is the chunk coordinate (world voxel origin / Chunk::SIZE)
+  bool loadChunk(glm::ivec3 coord, std::vector<uint8_t> &types);
+  void saveChunk(glm::ivec3 coord, std::vector<uint8_t> types);
+  // blocks until every queued save is on disk
+  void flush();
+
+ private:
+  RegionFile &getRegion(glm::ivec2 region);
+  void writerLoop();
+
+  std::string directory;
+
+  std::mutex regionsMutex;
+  std::unordered_map<uint64_t, std::unique_ptr<RegionFile>> regions;
+
+  std::mutex queueMutex;
+  std::condition_variable queueCondition;
+  std::condition_variable idleCondition;
+  std::unordered_map<uint64_t, std::vector<uint8_t>> pending;
+  // save taken out of pending that the writer has not finished yet
+  std::unordered_map<uint64_t, std::vector<uint8_t>>::node_type inFlight;
+  bool writing = false;
+  bool stopping = false;
+  std::thread writer;
+};
+}
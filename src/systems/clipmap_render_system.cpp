@@ -0,0 +1,197 @@
+#include "clipmap_render_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <iostream>
+
+namespace zx {
+
+struct ClipmapPushConstantData {
+  // xz rectangle (min.x, min.z, max.x, max.z) drawn by a finer level or by the voxel chunks
+  glm::vec4 hole{0.f};
+  glm::ivec2 origin{0};
+  float spacing = 1.f;
+  int level = 0;
+};
+
+ClipmapRenderSystem::ClipmapRenderSystem(
+    ZxDevice& device,
+    ZxPipelineQueue& pipelineQueue,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    int framesInFlight)
+    : zxDevice{device} {
+  createDescriptors(framesInFlight);
+  createIndexBuffer();
+  createPipelineLayout(globalSetLayout);
+  createPipeline(pipelineQueue, renderPass);
+}
+
+ClipmapRenderSystem::~ClipmapRenderSystem() {
+  vkDestroyPipelineLayout(zxDevice.device(), pipelineLayout, nullptr);
+}
+
+void ClipmapRenderSystem::createDescriptors(int framesInFlight) {
+  descriptorPool =
+      ZxDescriptorPool::Builder(zxDevice)
+          .setMaxSets(framesInFlight)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight)
+          .build();
+  heightSetLayout =
+      ZxDescriptorSetLayout::Builder(zxDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .build();
+
+  frames.resize(framesInFlight);
+  for (auto& frame : frames) {
+    frame.buffer = std::make_unique<ZxBuffer>(
+        zxDevice,
+        sizeof(float),
+        TerrainClipmap::LEVEL_COUNT * TerrainClipmap::GRID * TerrainClipmap::GRID,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    frame.buffer->map();
+
+    auto bufferInfo = frame.buffer->descriptorInfo();
+    ZxDescriptorWriter(*heightSetLayout, *descriptorPool)
+        .writeBuffer(0, &bufferInfo)
+        .build(frame.descriptorSet);
+  }
+}
+
+void ClipmapRenderSystem::createIndexBuffer() {
+  // the grid is indexed in logical (camera relative) order, the vertex shader maps each
+  // logical vertex to its toroidal slot so the index buffer never changes
+  constexpr uint32_t grid = TerrainClipmap::GRID;
+  std::vector<uint32_t> indices{};
+  indices.reserve((grid - 1) * (grid - 1) * 6);
+  for (uint32_t j = 0; j < grid - 1; j++) {
+    for (uint32_t i = 0; i < grid - 1; i++) {
+      uint32_t v = j * grid + i;
+      indices.insert(indices.end(), {v, v + 1, v + grid + 1, v, v + grid + 1, v + grid});
+    }
+  }
+
+  indexCount = static_cast<uint32_t>(indices.size());
+  VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+  uint32_t indexSize = sizeof(indices[0]);
+
+  ZxBuffer stagingBuffer{
+      zxDevice,
+      indexSize,
+      indexCount,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+  };
+
+  stagingBuffer.map();
+  stagingBuffer.writeToBuffer((void*)indices.data());
+
+  indexBuffer = std::make_unique<ZxBuffer>(
+      zxDevice,
+      indexSize,
+      indexCount,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  zxDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+}
+
+void ClipmapRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ClipmapPushConstantData);
+
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+      globalSetLayout,
+      heightSetLayout->getDescriptorSetLayout()};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(zxDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    panic("Failed to create pipeline layout!");
+  }
+}
+
+void ClipmapRenderSystem::createPipeline(ZxPipelineQueue& pipelineQueue, VkRenderPass renderPass) {
+  assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
+
+  // positions are generated in the vertex shader, there is no vertex input
+  PipelineConfigInfo& pipelineConfig = pipelineQueue.add(
+      zxPipeline,
+      "shaders/clipmap_shader.vert.spv",
+      "shaders/clipmap_shader.frag.spv");
+  ZxPipeline::defaultPipelineConfigInfo(pipelineConfig, {}, {});
+  pipelineConfig.renderPass = renderPass;
+  pipelineConfig.pipelineLayout = pipelineLayout;
+}
+
+void ClipmapRenderSystem::uploadHeights(FrameHeights& frame, const TerrainClipmap& clipmap) {
+  float* heights = static_cast<float*>(frame.buffer->getMappedMemory());
+  for (int l = 0; l < TerrainClipmap::LEVEL_COUNT; l++) {
+    clipmap.copyLevel(
+        l,
+        frame.origins[l],
+        !frame.valid,
+        heights + l * TerrainClipmap::GRID * TerrainClipmap::GRID);
+    frame.origins[l] = clipmap.getLevel(l).origin;
+  }
+  frame.valid = true;
+}
+
+void ClipmapRenderSystem::renderTerrain(FrameInfo& frameInfo, const TerrainClipmap& clipmap) {
+  // this frame's fence has been waited on, so its copy of the heights is no longer read by the gpu
+  FrameHeights& frame = frames[frameInfo.frameIndex];
+  uploadHeights(frame, clipmap);
+
+  zxPipeline->bind(frameInfo.commandBuffer);
+
+  std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, frame.descriptorSet};
+  vkCmdBindDescriptorSets(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      pipelineLayout,
+      0,
+      static_cast<uint32_t>(descriptorSets.size()),
+      descriptorSets.data(),
+      0,
+      nullptr);
+
+  vkCmdBindIndexBuffer(frameInfo.commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+  for (int l = 0; l < TerrainClipmap::LEVEL_COUNT; l++) {
+    ClipmapPushConstantData push{};
+    push.origin = clipmap.getLevel(l).origin;
+    push.spacing = TerrainClipmap::spacing(l);
+    push.level = l;
+    if (l == 0) {
+      push.hole = clipmap.getVoxelRegion();
+    } else {
+      // leave one cell of the finer level as overlap so no gap opens between the two
+      float inner = TerrainClipmap::spacing(l - 1);
+      push.hole = clipmap.levelBounds(l - 1) + glm::vec4{inner, inner, -inner, -inner};
+    }
+
+    vkCmdPushConstants(
+        frameInfo.commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(ClipmapPushConstantData),
+        &push);
+    vkCmdDrawIndexed(frameInfo.commandBuffer, indexCount, 1, 0, 0, 0);
+  }
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../defines.hpp"
+#include "../zx_buffer.hpp"
+#include "../zx_descriptors.hpp"
+#include "../zx_device.hpp"
+#include "../zx_frame_info.hpp"
+#include "../zx_pipeline.hpp"
+#include "../zx_pipeline_queue.hpp"
+#include "../zx_swap_chain.hpp"
+#include "../terrain_clipmap.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace zx {
+class ClipmapRenderSystem {
+ public:
+  // the pipeline is added to pipelineQueue, the system can draw once the queue is built
+  ClipmapRenderSystem(
+      ZxDevice &device,
+      ZxPipelineQueue &pipelineQueue,
+      VkRenderPass renderPass,
+      VkDescriptorSetLayout globalSetLayout,
+      int framesInFlight);
+  ~ClipmapRenderSystem();
+
+  ClipmapRenderSystem(const ClipmapRenderSystem &) = delete;
+  ClipmapRenderSystem &operator=(const ClipmapRenderSystem &) = delete;
+
+  void renderTerrain(FrameInfo &frameInfo, const TerrainClipmap &clipmap);
+
+ private:
+  // per frame in flight copy of every level's heights, together with the origins it was written at
+  struct FrameHeights {
+    std::unique_ptr<ZxBuffer> buffer;
+    VkDescriptorSet descriptorSet;
+    std::array<glm::ivec2, TerrainClipmap::LEVEL_COUNT> origins{};
+    bool valid = false;
+  };
+
+  void createDescriptors(int framesInFlight);
+  void createIndexBuffer();
+  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+  void createPipeline(ZxPipelineQueue &pipelineQueue, VkRenderPass renderPass);
+  void uploadHeights(FrameHeights &frame, const TerrainClipmap &clipmap);
+
+  ZxDevice &zxDevice;
+
+  std::unique_ptr<ZxDescriptorPool> descriptorPool;
+  std::unique_ptr<ZxDescriptorSetLayout> heightSetLayout;
+  std::vector<FrameHeights> frames;
+
+  std::unique_ptr<ZxBuffer> indexBuffer;
+  uint32_t indexCount;
+
+  std::unique_ptr<ZxPipeline> zxPipeline;
+  VkPipelineLayout pipelineLayout;
+};
+}
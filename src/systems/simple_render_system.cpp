@@ -7,6 +7,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
@@ -14,85 +15,288 @@
 
 namespace zx {
 
-struct SimplePushConstantData {
-  glm::mat4 modelMatrix{1.f};
-  glm::mat4 normalMatrix{1.f};
-};
-
 SimpleRenderSystem::SimpleRenderSystem(
-    ZxDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+    ZxDevice& device,
+    ZxPipelineQueue& pipelineQueue,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    VkDescriptorSetLayout bindlessSetLayout,
+    int framesInFlight)
     : zxDevice{device} {
-  createPipelineLayout(globalSetLayout);
-  createPipeline(renderPass);
+  createPipelineLayout(globalSetLayout, bindlessSetLayout);
+  createCullResources(globalSetLayout, framesInFlight);
+  createPipeline(pipelineQueue, renderPass);
+  createInstanceBuffers(framesInFlight);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
   vkDestroyPipelineLayout(zxDevice.device(), pipelineLayout, nullptr);
+  vkDestroyPipelineLayout(zxDevice.device(), cullPipelineLayout, nullptr);
 }
 
-void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(SimplePushConstantData);
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+void SimpleRenderSystem::createPipelineLayout(
+    VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout bindlessSetLayout) {
+  // matrices and texture indices come from the object buffer in the global set, indexed by
+  // the instance attribute, and the textures from the bindless set
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, bindlessSetLayout};
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
   if (vkCreatePipelineLayout(zxDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
       VK_SUCCESS) {
     panic("Failed to create pipeline layout!");
   }
 }
 
-void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SimpleRenderSystem::createPipeline(ZxPipelineQueue& pipelineQueue, VkRenderPass renderPass) {
   assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-  PipelineConfigInfo pipelineConfig{};
-  ZxPipeline::defaultPipelineConfigInfo(pipelineConfig, ZxModel::Vertex::getBindingDescriptions(), ZxModel::Vertex::getAttributeDescriptions());
+  // binding 1 is the instance buffer, one object buffer index per instance
+  auto bindingDescriptions = ZxModel::Vertex::getBindingDescriptions();
+  bindingDescriptions.push_back({1, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_INSTANCE});
+  auto attributeDescriptions = ZxModel::Vertex::getAttributeDescriptions();
+  attributeDescriptions.push_back({4, 1, VK_FORMAT_R32_UINT, 0});
+
+  PipelineConfigInfo& pipelineConfig = pipelineQueue.add(
+      zxPipeline,
+      "shaders/simple_shader.vert.spv",
+      "shaders/simple_shader.frag.spv");
+  ZxPipeline::defaultPipelineConfigInfo(pipelineConfig, bindingDescriptions, attributeDescriptions);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  zxPipeline = std::make_unique<ZxPipeline>(
-      zxDevice,
-      "shaders/simple_shader.vert.spv",
-      "shaders/simple_shader.frag.spv",
-      pipelineConfig);
+  // meshlets facing away are only skipped when the rasterizer would drop their triangles too
+  backFaceCulling = (pipelineConfig.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+
+  pipelineQueue.addCompute(cullPipeline, "shaders/meshlet_cull.comp.spv", cullPipelineLayout);
+}
+
+void SimpleRenderSystem::createCullResources(
+    VkDescriptorSetLayout globalSetLayout, int framesInFlight) {
+  // meshlets of the model, instance buffer, indirect draws
+  cullSetLayout =
+      ZxDescriptorSetLayout::Builder(zxDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .build();
+
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+      globalSetLayout,
+      cullSetLayout->getDescriptorSetLayout()};
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(CullPush);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(zxDevice.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) !=
+      VK_SUCCESS) {
+    panic("Failed to create pipeline layout!");
+  }
+
+  cullFrames.resize(framesInFlight);
+  for (auto& frame : cullFrames) {
+    frame.descriptorPool =
+        ZxDescriptorPool::Builder(zxDevice)
+            .setMaxSets(MAX_CULLED_BATCHES)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_CULLED_BATCHES * 3)
+            .build();
+    frame.drawBuffer = std::make_unique<ZxBuffer>(
+        zxDevice,
+        sizeof(VkDrawIndexedIndirectCommand),
+        MAX_MESHLET_DRAWS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+}
+
+void SimpleRenderSystem::createInstanceBuffers(int framesInFlight) {
+  instanceBuffers.resize(framesInFlight);
+  for (auto& instanceBuffer : instanceBuffers) {
+    instanceBuffer = std::make_unique<ZxBuffer>(
+        zxDevice,
+        sizeof(uint32_t),
+        MAX_INSTANCES,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    instanceBuffer->map();
+  }
+}
+
+void SimpleRenderSystem::prepare(FrameInfo& frameInfo) {
+  auto& models = frameInfo.scene.models;
+  if (models.size() > MAX_INSTANCES) {
+    panic("Too many model instances for the instance buffer!");
+  }
+
+  // count the instances of every model, then lay the batches out back to back
+  batches.clear();
+  batchLookup.clear();
+  for (size_t i = 0; i < models.size(); i++) {
+    ZxModel* model = models.at(i).get();
+    if (model == nullptr) continue;
+    auto [it, inserted] = batchLookup.try_emplace(model, static_cast<uint32_t>(batches.size()));
+    if (inserted) batches.push_back(Batch{model, 0, 0, 0, 0});
+    batches[it->second].instanceCount++;
+  }
+  if (batches.empty()) return;
+
+  uint32_t firstInstance = 0;
+  for (auto& batch : batches) {
+    batch.firstInstance = firstInstance;
+    firstInstance += batch.instanceCount;
+    batch.instanceCount = 0;
+  }
+
+  auto& instanceBuffer = instanceBuffers[frameInfo.frameIndex];
+  uint32_t* instances = static_cast<uint32_t*>(instanceBuffer->getMappedMemory());
+  for (size_t i = 0; i < models.size(); i++) {
+    ZxModel* model = models.at(i).get();
+    if (model == nullptr) continue;
+    Batch& batch = batches[batchLookup[model]];
+    instances[batch.firstInstance + batch.instanceCount++] =
+        frameInfo.scene.transforms.indexOf(models.entityAt(i));
+  }
+  instanceBuffer->flush();
+
+  // per meshlet draws start past instance 0, which needs drawIndirectFirstInstance
+  if (meshletCulling && zxDevice.isDrawIndirectFirstInstanceEnabled()) {
+    cullMeshlets(frameInfo);
+  }
+}
+
+void SimpleRenderSystem::cullMeshlets(FrameInfo& frameInfo) {
+  CullFrame& frame = cullFrames[frameInfo.frameIndex];
+  // the sets were last used by the frame that had this index, its fence has been waited on
+  frame.descriptorPool->resetPool();
+
+  CullPush push{};
+  auto planes = frameInfo.camera.getFrustumPlanes();
+  std::copy(planes.begin(), planes.end(), push.frustumPlanes);
+  push.coneCulling = backFaceCulling ? 1 : 0;
+
+  auto instanceInfo = instanceBuffers[frameInfo.frameIndex]->descriptorInfo();
+  auto drawInfo = frame.drawBuffer->descriptorInfo();
+  uint32_t nextDraw = 0;
+  bool bound = false;
+  for (auto& batch : batches) {
+    if (!batch.model->hasMeshlets()) continue;
+    uint32_t drawCount = batch.model->getMeshletCount() * batch.instanceCount;
+    if (nextDraw + drawCount > MAX_MESHLET_DRAWS) continue;
+
+    VkDescriptorSet cullSet;
+    auto meshletInfo = batch.model->meshletInfo();
+    if (!ZxDescriptorWriter(*cullSetLayout, *frame.descriptorPool)
+             .writeBuffer(0, &meshletInfo)
+             .writeBuffer(1, &instanceInfo)
+             .writeBuffer(2, &drawInfo)
+             .build(cullSet)) {
+      // out of sets, the remaining batches are drawn whole
+      break;
+    }
+
+    if (!bound) {
+      cullPipeline->bind(frameInfo.commandBuffer);
+      vkCmdBindDescriptorSets(
+          frameInfo.commandBuffer,
+          VK_PIPELINE_BIND_POINT_COMPUTE,
+          cullPipelineLayout,
+          0,
+          1,
+          &frameInfo.globalDescriptorSet,
+          0,
+          nullptr);
+      bound = true;
+    }
+    vkCmdBindDescriptorSets(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        cullPipelineLayout,
+        1,
+        1,
+        &cullSet,
+        0,
+        nullptr);
+
+    push.meshletCount = batch.model->getMeshletCount();
+    push.instanceCount = batch.instanceCount;
+    push.firstInstance = batch.firstInstance;
+    push.firstDraw = nextDraw;
+    vkCmdPushConstants(
+        frameInfo.commandBuffer,
+        cullPipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(CullPush),
+        &push);
+    vkCmdDispatch(frameInfo.commandBuffer, (drawCount + 63) / 64, 1, 1);
+
+    batch.firstDraw = nextDraw;
+    batch.drawCount = drawCount;
+    nextDraw += drawCount;
+  }
+  if (!bound) return;
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
 }
 
 void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
+  if (batches.empty()) return;
+
   zxPipeline->bind(frameInfo.commandBuffer);
 
+  // bound once, objects with different textures need no binds between their draws
+  VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet, frameInfo.bindlessDescriptorSet};
   vkCmdBindDescriptorSets(
       frameInfo.commandBuffer,
       VK_PIPELINE_BIND_POINT_GRAPHICS,
       pipelineLayout,
       0,
-      1,
-      &frameInfo.globalDescriptorSet,
+      2,
+      descriptorSets,
       0,
       nullptr);
 
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr || obj.chunk != nullptr) continue;
-    SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
+  VkBuffer buffers[] = {instanceBuffers[frameInfo.frameIndex]->getBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(frameInfo.commandBuffer, 1, 1, buffers, offsets);
 
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(SimplePushConstantData),
-        &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+  VkBuffer drawBuffer = cullFrames[frameInfo.frameIndex].drawBuffer->getBuffer();
+  for (auto& batch : batches) {
+    batch.model->bind(frameInfo.commandBuffer);
+    if (batch.drawCount > 0) {
+      batch.model->drawIndirect(
+          frameInfo.commandBuffer,
+          drawBuffer,
+          static_cast<VkDeviceSize>(batch.firstDraw) * sizeof(VkDrawIndexedIndirectCommand),
+          batch.drawCount);
+    } else {
+      batch.model->draw(frameInfo.commandBuffer, batch.instanceCount, batch.firstInstance);
+    }
   }
 }
 }
\ No newline at end of file
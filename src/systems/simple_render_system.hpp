@@ -4,31 +4,100 @@
 #include "../zx_camera.hpp"
 #include "../zx_device.hpp"
 #include "../zx_frame_info.hpp"
-#include "../zx_game_object.hpp"
+#include "../zx_buffer.hpp"
+#include "../zx_descriptors.hpp"
+#include "../zx_scene.hpp"
 #include "../zx_pipeline.hpp"
+#include "../zx_pipeline_queue.hpp"
 
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace zx {
+// Objects sharing a model are drawn with one instanced draw. Every frame the object buffer
+// indices of all objects are written into a per frame instance buffer, grouped by model, and
+// read by the vertex shader as a per instance attribute.
+//
+// Models split into meshlets are culled per meshlet instead: a compute pass writes one
+// indexed indirect draw per meshlet and instance, with an instance count of 0 for the ones
+// outside the frustum or facing away from the camera, and the model is drawn from those.
 class SimpleRenderSystem {
  public:
+  static constexpr uint32_t MAX_INSTANCES = 16384;
+  // indirect draws the culling pass can write per frame, batches past it are drawn whole
+  static constexpr uint32_t MAX_MESHLET_DRAWS = 65536;
+  // each culled batch takes a descriptor set from a per frame pool
+  static constexpr uint32_t MAX_CULLED_BATCHES = 64;
+
+  // the pipeline is added to pipelineQueue, the system can draw once the queue is built
   SimpleRenderSystem(
-      ZxDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+      ZxDevice &device,
+      ZxPipelineQueue &pipelineQueue,
+      VkRenderPass renderPass,
+      VkDescriptorSetLayout globalSetLayout,
+      VkDescriptorSetLayout bindlessSetLayout,
+      int framesInFlight);
   ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
   SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
+  // records into the primary command buffer before the render pass begins: lays out the
+  // instances and culls the meshlets of the models that have them
+  void prepare(FrameInfo &frameInfo);
+  // draws what prepare laid out, may run on another thread once prepare returned
   void renderGameObjects(FrameInfo &frameInfo);
 
+  bool meshletCulling = true;
+
  private:
-  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void createPipelineLayout(
+      VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout bindlessSetLayout);
+  void createPipeline(ZxPipelineQueue &pipelineQueue, VkRenderPass renderPass);
+  void createInstanceBuffers(int framesInFlight);
+  void createCullResources(VkDescriptorSetLayout globalSetLayout, int framesInFlight);
+  void cullMeshlets(FrameInfo &frameInfo);
+
+  struct Batch {
+    ZxModel *model;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    // indirect draws written for the batch by the culling pass, none if drawn whole
+    uint32_t firstDraw;
+    uint32_t drawCount;
+  };
+
+  struct CullPush {
+    glm::vec4 frustumPlanes[6];
+    uint32_t meshletCount;
+    uint32_t instanceCount;
+    uint32_t firstInstance;
+    uint32_t firstDraw;
+    // 1 if the pipeline culls back faces, the normal cone test only holds for those
+    uint32_t coneCulling;
+  };
+
+  struct CullFrame {
+    std::unique_ptr<ZxDescriptorPool> descriptorPool;
+    std::unique_ptr<ZxBuffer> drawBuffer;
+  };
 
   ZxDevice &zxDevice;
 
+  std::vector<std::unique_ptr<ZxBuffer>> instanceBuffers;
+  // rebuilt every frame, kept to avoid reallocating
+  std::vector<Batch> batches;
+  std::unordered_map<ZxModel *, uint32_t> batchLookup;
+
   std::unique_ptr<ZxPipeline> zxPipeline;
   VkPipelineLayout pipelineLayout;
+  bool backFaceCulling = false;
+
+  std::unique_ptr<ZxDescriptorSetLayout> cullSetLayout;
+  std::vector<CullFrame> cullFrames;
+  std::unique_ptr<ZxComputePipeline> cullPipeline;
+  VkPipelineLayout cullPipelineLayout;
 };
 }
\ No newline at end of file
@@ -14,85 +14,116 @@
 
 namespace zx {
 
-struct VoxelPushConstantData {
-  glm::mat4 modelMatrix{1.f};
-  glm::mat4 normalMatrix{1.f};
-};
+const std::vector<std::string> VoxelRenderSystem::BLOCK_TEXTURES{
+    "../textures/blocks/stone.png",
+    "../textures/blocks/grass.png"};
 
 VoxelRenderSystem::VoxelRenderSystem(
-    ZxDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+    ZxDevice& device,
+    ZxPipelineQueue& pipelineQueue,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout globalSetLayout)
     : zxDevice{device} {
+  createBlockTextures();
   createPipelineLayout(globalSetLayout);
-  createPipeline(renderPass);
+  createPipeline(pipelineQueue, renderPass);
 }
 
 VoxelRenderSystem::~VoxelRenderSystem() {
   vkDestroyPipelineLayout(zxDevice.device(), pipelineLayout, nullptr);
 }
 
-void VoxelRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(VoxelPushConstantData);
+void VoxelRenderSystem::createBlockTextures() {
+  // a handful of small layers, loaded up front so no chunk is ever drawn untextured
+  blockTextures = std::make_unique<Texture>(zxDevice, BLOCK_TEXTURES);
+  info("Block textures: " + std::to_string(blockTextures->getLayerCount()) + " layers", 0);
+
+  blockSetLayout =
+      ZxDescriptorSetLayout::Builder(zxDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .build();
+  blockPool =
+      ZxDescriptorPool::Builder(zxDevice)
+          .setMaxSets(1)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+          .build();
+
+  // never rewritten, so one set serves every frame in flight
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.sampler = blockTextures->getSampler();
+  imageInfo.imageView = blockTextures->getImageView();
+  imageInfo.imageLayout = blockTextures->getImageLayout();
+  if (!ZxDescriptorWriter(*blockSetLayout, *blockPool).writeImage(0, &imageInfo).build(blockSet)) {
+    panic("Failed to allocate the block texture descriptor set!");
+  }
+}
 
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+void VoxelRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+  // matrices come from the object buffer in the global set, indexed by the first instance,
+  // block textures from set 1
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+      globalSetLayout,
+      blockSetLayout->getDescriptorSetLayout()};
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
   if (vkCreatePipelineLayout(zxDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
       VK_SUCCESS) {
     panic("Failed to create pipeline layout!");
   }
 }
 
-void VoxelRenderSystem::createPipeline(VkRenderPass renderPass) {
+void VoxelRenderSystem::createPipeline(ZxPipelineQueue& pipelineQueue, VkRenderPass renderPass) {
   assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-  PipelineConfigInfo pipelineConfig{};
-  ZxPipeline::defaultPipelineConfigInfo(pipelineConfig, Chunk::Vertex::getBindingDescriptions(), Chunk::Vertex::getAttributeDescriptions());
+  PipelineConfigInfo& pipelineConfig = pipelineQueue.add(
+      zxPipeline,
+      "shaders/voxel_shader.vert.spv",
+      "shaders/voxel_shader.frag.spv");
+  ZxPipeline::defaultPipelineConfigInfo(pipelineConfig, Chunk::getVertexBindingDescriptions(), Chunk::getVertexAttributeDescriptions());
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  zxPipeline = std::make_unique<ZxPipeline>(
-      zxDevice,
-      "shaders/voxel_shader.vert.spv",
-      "shaders/voxel_shader.frag.spv",
-      pipelineConfig);
+}
+
+int VoxelRenderSystem::selectLod(const glm::vec3& cameraPosition, const glm::vec3& chunkPosition) const {
+  glm::vec3 center = chunkPosition + glm::vec3{Chunk::SIZE * 0.5f};
+  float distance = glm::length(center - cameraPosition);
+
+  int lod = 0;
+  while (lod < static_cast<int>(lodDistances.size()) && distance > lodDistances[lod]) {
+    lod++;
+  }
+  return lod;
 }
 
 void VoxelRenderSystem::renderChunks(FrameInfo& frameInfo) {
+  renderChunks(frameInfo, 0, frameInfo.scene.chunks.size());
+}
+
+void VoxelRenderSystem::renderChunks(FrameInfo& frameInfo, size_t first, size_t last) {
   zxPipeline->bind(frameInfo.commandBuffer);
 
+  VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet, blockSet};
   vkCmdBindDescriptorSets(
       frameInfo.commandBuffer,
       VK_PIPELINE_BIND_POINT_GRAPHICS,
       pipelineLayout,
       0,
-      1,
-      &frameInfo.globalDescriptorSet,
+      2,
+      descriptorSets,
       0,
       nullptr);
 
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.chunk == nullptr) continue;
-    VoxelPushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
-
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(VoxelPushConstantData),
-        &push);
-    obj.chunk->bind(frameInfo.commandBuffer);
-    obj.chunk->draw(frameInfo.commandBuffer);
+  auto& chunks = frameInfo.scene.chunks;
+  for (size_t i = first; i < last; i++) {
+    auto& chunk = chunks.at(i);
+    uint32_t objectIndex = frameInfo.scene.transforms.indexOf(chunks.entityAt(i));
+    chunk->bind(frameInfo.commandBuffer);
+    chunk->draw(frameInfo.commandBuffer, objectIndex);
   }
 }
 }
\ No newline at end of file
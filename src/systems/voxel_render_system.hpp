@@ -2,32 +2,60 @@
 
 #include "../defines.hpp"
 #include "../zx_camera.hpp"
+#include "../zx_descriptors.hpp"
 #include "../zx_device.hpp"
 #include "../zx_frame_info.hpp"
-#include "../zx_game_object.hpp"
+#include "../zx_scene.hpp"
 #include "../zx_pipeline.hpp"
+#include "../zx_pipeline_queue.hpp"
+#include "../zx_texture.hpp"
 
+#include <array>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace zx {
 class VoxelRenderSystem {
  public:
+  // layers of the block texture array bound to set 1, layer n textures VoxelType n + 1
+  static const std::vector<std::string> BLOCK_TEXTURES;
+
+  // the pipeline is added to pipelineQueue, the system can draw once the queue is built
   VoxelRenderSystem(
-      ZxDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+      ZxDevice &device,
+      ZxPipelineQueue &pipelineQueue,
+      VkRenderPass renderPass,
+      VkDescriptorSetLayout globalSetLayout);
   ~VoxelRenderSystem();
 
   VoxelRenderSystem(const VoxelRenderSystem &) = delete;
   VoxelRenderSystem &operator=(const VoxelRenderSystem &) = delete;
 
   void renderChunks(FrameInfo& frameInfo);
+  // chunks [first, last) of the scene's chunk pool, lets recording be split across threads
+  void renderChunks(FrameInfo& frameInfo, size_t first, size_t last);
+
+  // camera distance to a chunk centre at which LOD n + 1 takes over from LOD n
+  std::array<float, Chunk::LOD_COUNT - 1> lodDistances{96.f, 192.f, 384.f};
+
+  // LOD a chunk at chunkPosition should be meshed at, chunks are drawn at whatever LOD
+  // their resident mesh has
+  int selectLod(const glm::vec3 &cameraPosition, const glm::vec3 &chunkPosition) const;
 
  private:
+
+  void createBlockTextures();
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void createPipeline(ZxPipelineQueue &pipelineQueue, VkRenderPass renderPass);
 
   ZxDevice &zxDevice;
 
+  std::unique_ptr<Texture> blockTextures;
+  std::unique_ptr<ZxDescriptorSetLayout> blockSetLayout;
+  std::unique_ptr<ZxDescriptorPool> blockPool;
+  VkDescriptorSet blockSet;
+
   std::unique_ptr<ZxPipeline> zxPipeline;
   VkPipelineLayout pipelineLayout;
 };
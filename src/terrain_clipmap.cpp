@@ -0,0 +1,92 @@
+#include "terrain_clipmap.hpp"
+
+#include "chunk.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace zx {
+
+TerrainClipmap::TerrainClipmap() {
+  for (auto &level : levels) {
+    level.heights.resize(GRID * GRID);
+  }
+}
+
+template <typename Fn>
+void TerrainClipmap::forEachExposedSlot(glm::ivec2 from, glm::ivec2 to, bool full, Fn &&fn) {
+  glm::ivec2 delta = to - from;
+  if (full || std::abs(delta.x) >= GRID || std::abs(delta.y) >= GRID) {
+    for (int gz = to.y; gz < to.y + GRID; gz++) {
+      for (int gx = to.x; gx < to.x + GRID; gx++) {
+        fn(slot(gx, gz), gx, gz);
+      }
+    }
+    return;
+  }
+
+  // columns that scrolled in, over the full height of the new window
+  int x0 = delta.x > 0 ? from.x + GRID : to.x;
+  int x1 = delta.x > 0 ? to.x + GRID : from.x;
+  for (int gz = to.y; gz < to.y + GRID; gz++) {
+    for (int gx = x0; gx < x1; gx++) {
+      fn(slot(gx, gz), gx, gz);
+    }
+  }
+
+  // rows that scrolled in, minus the corner already covered by the columns
+  int z0 = delta.y > 0 ? from.y + GRID : to.y;
+  int z1 = delta.y > 0 ? to.y + GRID : from.y;
+  for (int gz = z0; gz < z1; gz++) {
+    for (int gx = to.x; gx < to.x + GRID; gx++) {
+      if (gx >= x0 && gx < x1) continue;
+      fn(slot(gx, gz), gx, gz);
+    }
+  }
+}
+
+void TerrainClipmap::update(const glm::vec3 &cameraPosition) {
+  regenerated = 0;
+  for (int l = 0; l < LEVEL_COUNT; l++) {
+    Level &level = levels[l];
+    float s = spacing(l);
+    glm::ivec2 origin{
+        static_cast<int>(std::floor(cameraPosition.x / s)) - GRID / 2,
+        static_cast<int>(std::floor(cameraPosition.z / s)) - GRID / 2};
+
+    if (level.valid && origin == level.origin) continue;
+
+    forEachExposedSlot(level.origin, origin, !level.valid, [&](int slot, int gx, int gz) {
+      level.heights[slot] = Chunk::terrainHeight(gx * s, gz * s);
+      regenerated++;
+    });
+    level.origin = origin;
+    level.valid = true;
+  }
+}
+
+void TerrainClipmap::copyLevel(int level, glm::ivec2 from, bool full, float *dst) const {
+  const Level &src = levels[level];
+  if (full) {
+    std::memcpy(dst, src.heights.data(), sizeof(float) * GRID * GRID);
+    return;
+  }
+  if (from == src.origin) return;
+
+  forEachExposedSlot(from, src.origin, false, [&](int slot, int, int) {
+    dst[slot] = src.heights[slot];
+  });
+}
+
+glm::vec4 TerrainClipmap::levelBounds(int level) const {
+  float s = spacing(level);
+  glm::ivec2 origin = levels[level].origin;
+  return glm::vec4{
+      origin.x * s,
+      origin.y * s,
+      (origin.x + GRID - 1) * s,
+      (origin.y + GRID - 1) * s};
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "defines.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace zx {
+
+// Nested grids of terrain heights centred on the camera, used to draw the horizon beyond
+// the voxel chunks. Every level has twice the spacing of the previous one and is stored
+// toroidally: world grid point (gx, gz) lives in slot (gz mod GRID, gx mod GRID), so when the
+// camera moves only the strips that scrolled into view have to be regenerated.
+class TerrainClipmap {
+ public:
+  static constexpr int LEVEL_COUNT = 5;
+  static constexpr int GRID = 64;
+  static constexpr float BASE_SPACING = 4.f;
+
+  struct Level {
+    // world grid coordinate, in units of the level spacing, of the first row and column
+    glm::ivec2 origin{};
+    std::vector<float> heights{};
+    bool valid = false;
+  };
+
+  TerrainClipmap();
+
+  TerrainClipmap(const TerrainClipmap &) = delete;
+  TerrainClipmap &operator=(const TerrainClipmap &) = delete;
+
+  void update(const glm::vec3 &cameraPosition);
+
+  // copies into dst the heights of a level that changed since it was last copied at origin `from`
+  void copyLevel(int level, glm::ivec2 from, bool full, float *dst) const;
+
+  // world xz rectangle (min.x, min.z, max.x, max.z) covered by a level
+  glm::vec4 levelBounds(int level) const;
+  // xz rectangle drawn by voxel chunks, the finest level leaves a hole there
+  void setVoxelRegion(glm::vec4 region) { voxelRegion = region; }
+  glm::vec4 getVoxelRegion() const { return voxelRegion; }
+
+  const Level &getLevel(int level) const { return levels[level]; }
+  static float spacing(int level) { return BASE_SPACING * static_cast<float>(1 << level); }
+  static int slot(int gx, int gz) { return (gz & (GRID - 1)) * GRID + (gx & (GRID - 1)); }
+
+  // number of heights sampled by the last update
+  uint32_t lastRegenerated() const { return regenerated; }
+
+ private:
+  template <typename Fn>
+  static void forEachExposedSlot(glm::ivec2 from, glm::ivec2 to, bool full, Fn &&fn);
+
+  std::array<Level, LEVEL_COUNT> levels{};
+  glm::vec4 voxelRegion{0.f};
+  uint32_t regenerated = 0;
+};
+}
@@ -0,0 +1,257 @@
+#include "texture_codec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace zx {
+
+namespace {
+float srgbToLinear(uint8_t value) {
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> t{};
+    for (int i = 0; i < 256; i++) {
+      float c = static_cast<float>(i) / 255.f;
+      t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return t;
+  }();
+  return table[value];
+}
+
+uint8_t linearToSrgb(float value) {
+  float c = std::clamp(value, 0.f, 1.f);
+  c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+  return static_cast<uint8_t>(std::lround(c * 255.f));
+}
+
+uint16_t packRGB565(const float rgb[3]) {
+  auto quantize = [](float value, int max) {
+    return static_cast<uint16_t>(std::clamp(std::lround(value * max / 255.f), 0l, static_cast<long>(max)));
+  };
+  return static_cast<uint16_t>(
+      (quantize(rgb[0], 31) << 11) | (quantize(rgb[1], 63) << 5) | quantize(rgb[2], 31));
+}
+
+void unpackRGB565(uint16_t color, int rgb[3]) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+// the four palette entries of a block, alpha 0 marks the transparent entry
+void blockPalette(uint16_t c0, uint16_t c1, int palette[4][4]) {
+  unpackRGB565(c0, palette[0]);
+  unpackRGB565(c1, palette[1]);
+  palette[0][3] = palette[1][3] = 255;
+  for (int k = 0; k < 3; k++) {
+    if (c0 > c1) {
+      palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+      palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+    } else {
+      palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+      palette[3][k] = 0;
+    }
+  }
+  palette[2][3] = 255;
+  palette[3][3] = c0 > c1 ? 255 : 0;
+}
+}  // namespace
+
+std::vector<TextureCodec::Level> TextureCodec::generateMips(
+    const uint8_t *rgba, uint32_t width, uint32_t height) {
+  std::vector<Level> levels;
+  levels.push_back(Level{width, height, std::vector<uint8_t>(rgba, rgba + width * height * 4)});
+
+  while (levels.back().width > 1 || levels.back().height > 1) {
+    const Level &src = levels.back();
+    Level dst{std::max(src.width / 2, 1u), std::max(src.height / 2, 1u), {}};
+    dst.data.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+    for (uint32_t y = 0; y < dst.height; y++) {
+      for (uint32_t x = 0; x < dst.width; x++) {
+        // odd sizes fold their last row or column into the previous texel
+        uint32_t x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+        uint32_t y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+        const uint8_t *texels[4] = {
+            &src.data[(y0 * src.width + x0) * 4],
+            &src.data[(y0 * src.width + x1) * 4],
+            &src.data[(y1 * src.width + x0) * 4],
+            &src.data[(y1 * src.width + x1) * 4]};
+
+        uint8_t *out = &dst.data[(static_cast<size_t>(y) * dst.width + x) * 4];
+        for (int k = 0; k < 3; k++) {
+          float sum = 0.f;
+          for (const uint8_t *texel : texels) sum += srgbToLinear(texel[k]);
+          out[k] = linearToSrgb(sum * 0.25f);
+        }
+        int alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+        out[3] = static_cast<uint8_t>((alpha + 2) / 4);
+      }
+    }
+    levels.push_back(std::move(dst));
+  }
+  return levels;
+}
+
+size_t TextureCodec::bc1Size(uint32_t width, uint32_t height) {
+  return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BC1_BLOCK_SIZE;
+}
+
+std::vector<uint8_t> TextureCodec::encodeBC1(const uint8_t *rgba, uint32_t width, uint32_t height) {
+  std::vector<uint8_t> blocks(bc1Size(width, height));
+  uint32_t blocksX = (width + 3) / 4;
+  uint32_t blocksY = (height + 3) / 4;
+
+  uint8_t texels[16][4];
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+        uint32_t y = std::min(by * 4 + i / 4, height - 1);
+        std::memcpy(texels[i], &rgba[(static_cast<size_t>(y) * width + x) * 4], 4);
+      }
+      encodeBlock(texels, &blocks[(static_cast<size_t>(by) * blocksX + bx) * BC1_BLOCK_SIZE]);
+    }
+  }
+  return blocks;
+}
+
+void TextureCodec::decodeBC1(const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgba) {
+  uint32_t blocksX = (width + 3) / 4;
+  uint32_t blocksY = (height + 3) / 4;
+
+  uint8_t texels[16][4];
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      decodeBlock(&blocks[(static_cast<size_t>(by) * blocksX + bx) * BC1_BLOCK_SIZE], texels);
+      for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = bx * 4 + i % 4;
+        uint32_t y = by * 4 + i / 4;
+        if (x >= width || y >= height) continue;
+        std::memcpy(&rgba[(static_cast<size_t>(y) * width + x) * 4], texels[i], 4);
+      }
+    }
+  }
+}
+
+void TextureCodec::encodeBlock(const uint8_t texels[16][4], uint8_t *block) {
+  // endpoints on the principal axis of the opaque texels' colours
+  bool transparent = false;
+  int opaque = 0;
+  float mean[3] = {0.f, 0.f, 0.f};
+  for (int i = 0; i < 16; i++) {
+    if (texels[i][3] < 128) {
+      transparent = true;
+      continue;
+    }
+    for (int k = 0; k < 3; k++) mean[k] += texels[i][k];
+    opaque++;
+  }
+
+  uint16_t c0 = 0;
+  uint16_t c1 = 0;
+  if (opaque > 0) {
+    for (float &m : mean) m /= static_cast<float>(opaque);
+
+    float covariance[6] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+    for (int i = 0; i < 16; i++) {
+      if (texels[i][3] < 128) continue;
+      float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2]};
+      covariance[0] += d[0] * d[0];
+      covariance[1] += d[0] * d[1];
+      covariance[2] += d[0] * d[2];
+      covariance[3] += d[1] * d[1];
+      covariance[4] += d[1] * d[2];
+      covariance[5] += d[2] * d[2];
+    }
+
+    // power iteration, converges in a few steps for the dominant axis
+    float axis[3] = {1.f, 1.f, 1.f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+      float next[3] = {
+          covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+          covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+          covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+      float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+      if (length < 1e-6f) break;
+      for (int k = 0; k < 3; k++) axis[k] = next[k] / length;
+    }
+
+    float tMin = 0.f;
+    float tMax = 0.f;
+    for (int i = 0; i < 16; i++) {
+      if (texels[i][3] < 128) continue;
+      float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] +
+                (texels[i][2] - mean[2]) * axis[2];
+      tMin = std::min(tMin, t);
+      tMax = std::max(tMax, t);
+    }
+    // pulled in slightly, the extremes are rarely worth a palette entry of their own
+    float inset = (tMax - tMin) / 16.f;
+    tMin += inset;
+    tMax -= inset;
+
+    float e0[3];
+    float e1[3];
+    for (int k = 0; k < 3; k++) {
+      e0[k] = mean[k] + axis[k] * tMax;
+      e1[k] = mean[k] + axis[k] * tMin;
+    }
+    c0 = packRGB565(e0);
+    c1 = packRGB565(e1);
+  }
+
+  // the first endpoint selects the mode: greater for four colours, not greater for three
+  // colours and transparent
+  if ((c0 < c1 && !transparent) || (c0 > c1 && transparent)) std::swap(c0, c1);
+
+  int palette[4][4];
+  blockPalette(c0, c1, palette);
+  uint32_t indices = 0;
+  int usable = c0 > c1 ? 4 : 3;
+  for (int i = 0; i < 16; i++) {
+    uint32_t best = 3;
+    if (texels[i][3] >= 128 || !transparent) {
+      int bestError = INT32_MAX;
+      for (int p = 0; p < usable; p++) {
+        int error = 0;
+        for (int k = 0; k < 3; k++) {
+          int d = palette[p][k] - texels[i][k];
+          error += d * d;
+        }
+        if (error < bestError) {
+          bestError = error;
+          best = static_cast<uint32_t>(p);
+        }
+      }
+    }
+    indices |= best << (i * 2);
+  }
+
+  block[0] = static_cast<uint8_t>(c0 & 0xff);
+  block[1] = static_cast<uint8_t>(c0 >> 8);
+  block[2] = static_cast<uint8_t>(c1 & 0xff);
+  block[3] = static_cast<uint8_t>(c1 >> 8);
+  for (int b = 0; b < 4; b++) block[4 + b] = static_cast<uint8_t>(indices >> (b * 8));
+}
+
+void TextureCodec::decodeBlock(const uint8_t *block, uint8_t texels[16][4]) {
+  uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+  uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+  uint32_t indices = static_cast<uint32_t>(block[4]) | (static_cast<uint32_t>(block[5]) << 8) |
+                     (static_cast<uint32_t>(block[6]) << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+  int palette[4][4];
+  blockPalette(c0, c1, palette);
+  for (int i = 0; i < 16; i++) {
+    const int *entry = palette[(indices >> (i * 2)) & 3];
+    for (int k = 0; k < 4; k++) texels[i][k] = static_cast<uint8_t>(entry[k]);
+  }
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zx {
+
+// CPU side image processing for textures converted offline: sRGB correct mip chains and
+// BC1 (DXT1) block compression. BC1 stores every 4x4 block in 8 bytes, two RGB565
+// endpoints and a 2 bit palette index per texel, an eighth of RGBA8. Blocks with texels
+// below half alpha use the three colour mode, whose fourth entry is transparent black.
+class TextureCodec {
+ public:
+  static constexpr size_t BC1_BLOCK_SIZE = 8;
+
+  struct Level {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> data;
+  };
+
+  // full chain down to 1x1 starting with a copy of the image, each level a 2x2 box filter
+  // of the previous one in linear space
+  static std::vector<Level> generateMips(const uint8_t *rgba, uint32_t width, uint32_t height);
+
+  static size_t bc1Size(uint32_t width, uint32_t height);
+  // rgba is width * height RGBA8 texels, partial edge blocks repeat their last row and column
+  static std::vector<uint8_t> encodeBC1(const uint8_t *rgba, uint32_t width, uint32_t height);
+  // the inverse, for devices that cannot sample BC1
+  static void decodeBC1(const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgba);
+
+ private:
+  static void encodeBlock(const uint8_t texels[16][4], uint8_t *block);
+  static void decodeBlock(const uint8_t *block, uint8_t texels[16][4]);
+};
+}
@@ -0,0 +1,164 @@
+#include "texture_container.hpp"
+
+#include "texture_codec.hpp"
+#include "zx_utils.hpp"
+
+#include "../external/stb/stb_image.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace zx {
+
+namespace {
+constexpr char MAGIC[4] = {'Z', 'X', 'T', 'X'};
+// more levels than a 2^31 texel wide image has
+constexpr uint32_t MAX_LEVELS = 32;
+
+size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+size_t TextureContainer::levelSize(Format format, uint32_t width, uint32_t height) {
+  if (format == Format::bc1Srgb) return TextureCodec::bc1Size(width, height);
+  return static_cast<size_t>(width) * height * 4;
+}
+
+bool TextureContainer::statSource(const std::string &sourcePath, uint64_t &size, int64_t &time) {
+  std::error_code error;
+  size = std::filesystem::file_size(sourcePath, error);
+  if (error) return false;
+  auto writeTime = std::filesystem::last_write_time(sourcePath, error);
+  if (error) return false;
+  time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+  return true;
+}
+
+bool TextureContainer::open(const std::string &sourcePath, const std::string &containerPath) {
+  header = nullptr;
+  if (!file.open(containerPath) || file.size() < sizeof(Header)) return false;
+
+  const auto *candidate = reinterpret_cast<const Header *>(file.data());
+  bool valid = std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+               candidate->version == VERSION &&
+               (candidate->format == static_cast<uint32_t>(Format::rgba8Srgb) ||
+                candidate->format == static_cast<uint32_t>(Format::bc1Srgb)) &&
+               candidate->width > 0 && candidate->height > 0 && candidate->levelCount > 0 &&
+               candidate->levelCount <= MAX_LEVELS &&
+               file.size() >= sizeof(Header) + candidate->levelCount * sizeof(LevelEntry);
+  // no image to compare with leaves the container as all there is
+  uint64_t sourceSize = 0;
+  int64_t sourceTime = 0;
+  if (valid && statSource(sourcePath, sourceSize, sourceTime)) {
+    valid = sourceSize == candidate->sourceSize && sourceTime == candidate->sourceTime;
+  }
+  if (!valid) {
+    file.close();
+    return false;
+  }
+
+  header = candidate;
+  for (uint32_t l = 0; l < header->levelCount; l++) {
+    const LevelEntry &entry = level(l);
+    if (entry.offset % LEVEL_ALIGNMENT != 0 ||
+        entry.size != levelSize(format(), levelWidth(l), levelHeight(l)) ||
+        entry.offset > file.size() || entry.size > file.size() - entry.offset) {
+      header = nullptr;
+      file.close();
+      return false;
+    }
+  }
+  return true;
+}
+
+const TextureContainer::LevelEntry &TextureContainer::level(uint32_t level) const {
+  return reinterpret_cast<const LevelEntry *>(file.data() + sizeof(Header))[level];
+}
+
+const uint8_t *TextureContainer::levelData(uint32_t level) const {
+  return file.data() + this->level(level).offset;
+}
+
+size_t TextureContainer::levelSize(uint32_t level) const {
+  return static_cast<size_t>(this->level(level).size);
+}
+
+bool TextureContainer::convert(const std::string &imagePath, const std::string &containerPath) {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  Header header{};
+  if (!statSource(imagePath, header.sourceSize, header.sourceTime)) {
+    info("Failed to load image: " + imagePath, 1);
+    return false;
+  }
+
+  int width, height, channels;
+  uint8_t *pixels = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
+  if (pixels == nullptr) {
+    info("Failed to load image: " + imagePath, 1);
+    return false;
+  }
+  std::vector<TextureCodec::Level> levels =
+      TextureCodec::generateMips(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+  stbi_image_free(pixels);
+
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.format = static_cast<uint32_t>(Format::bc1Srgb);
+  header.width = static_cast<uint32_t>(width);
+  header.height = static_cast<uint32_t>(height);
+  header.levelCount = static_cast<uint32_t>(levels.size());
+
+  std::vector<std::vector<uint8_t>> blocks;
+  std::vector<LevelEntry> entries;
+  size_t offset = alignUp(sizeof(Header) + levels.size() * sizeof(LevelEntry), LEVEL_ALIGNMENT);
+  for (const auto &level : levels) {
+    blocks.push_back(TextureCodec::encodeBC1(level.data.data(), level.width, level.height));
+    entries.push_back(LevelEntry{offset, blocks.back().size()});
+    offset = alignUp(offset + blocks.back().size(), LEVEL_ALIGNMENT);
+  }
+
+  // written next to the old file and renamed over it, a reader never maps a partial file
+  std::string tempPath = containerPath + ".tmp";
+  {
+    std::ofstream out{tempPath, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(
+        reinterpret_cast<const char *>(entries.data()),
+        static_cast<std::streamsize>(entries.size() * sizeof(LevelEntry)));
+    const char padding[LEVEL_ALIGNMENT] = {};
+    for (size_t l = 0; l < blocks.size(); l++) {
+      out.write(
+          padding,
+          static_cast<std::streamsize>(entries[l].offset - static_cast<uint64_t>(out.tellp())));
+      out.write(
+          reinterpret_cast<const char *>(blocks[l].data()),
+          static_cast<std::streamsize>(blocks[l].size()));
+    }
+    if (!out) {
+      info("Failed to write texture: " + containerPath, 1);
+      return false;
+    }
+  }
+  if (!replaceFile(tempPath, containerPath)) {
+    info("Failed to replace texture: " + containerPath, 1);
+    return false;
+  }
+
+  float convertTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                          std::chrono::high_resolution_clock::now() - start)
+                          .count();
+  info(
+      containerPath + ": " + std::to_string(levels.size()) + " levels, " +
+          std::to_string(offset / 1024) + " KiB, converted in " + std::to_string(convertTime) +
+          " ms",
+      1);
+  return true;
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_mapped_file.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace zx {
+
+// Texture file in the spirit of KTX2, written offline by convert: a fixed header, one
+// (offset, size) entry per mip level and the levels themselves, largest first, each
+// stored exactly as it is copied into the image. Loading maps the file and copies the
+// levels into a staging buffer, nothing is decoded or generated on the way.
+//
+// The header records the size and modification time of the image it was converted
+// from, a container whose image has changed since is ignored and the image loaded instead.
+class TextureContainer {
+ public:
+  static constexpr const char *EXTENSION = ".zxtex";
+  // 2: the source image size and time are recorded
+  static constexpr uint32_t VERSION = 2;
+  // level data starts on this boundary, enough for any block size and copy offset rule
+  static constexpr size_t LEVEL_ALIGNMENT = 16;
+
+  enum class Format : uint32_t {
+    rgba8Srgb = 0,
+    bc1Srgb = 1,
+  };
+
+  // maps containerPath and checks its header, level table and source image, false if it
+  // is missing, malformed or stale
+  bool open(const std::string &sourcePath, const std::string &containerPath);
+
+  // decodes an image, builds its mip chain and writes it BC1 compressed
+  static bool convert(const std::string &imagePath, const std::string &containerPath);
+
+  Format format() const { return static_cast<Format>(header->format); }
+  uint32_t width() const { return header->width; }
+  uint32_t height() const { return header->height; }
+  uint32_t levelCount() const { return header->levelCount; }
+  uint32_t levelWidth(uint32_t level) const { return std::max(header->width >> level, 1u); }
+  uint32_t levelHeight(uint32_t level) const { return std::max(header->height >> level, 1u); }
+  const uint8_t *levelData(uint32_t level) const;
+  size_t levelSize(uint32_t level) const;
+
+  // bytes a level of the given size takes in format
+  static size_t levelSize(Format format, uint32_t width, uint32_t height);
+
+ private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+  };
+
+  struct LevelEntry {
+    // from the start of the file
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  const LevelEntry &level(uint32_t level) const;
+  static bool statSource(const std::string &sourcePath, uint64_t &size, int64_t &time);
+
+  ZxMappedFile file;
+  const Header *header = nullptr;
+};
+}
@@ -0,0 +1,74 @@
+#include "zx_bindless_set.hpp"
+
+#include "zx_buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace zx {
+
+ZxBindlessSet::ZxBindlessSet(ZxDevice &device)
+    : zxDevice{device}, capacity{std::min(MAX_TEXTURES, device.getMaxBindlessTextures())} {
+  // unwritten slots are never sampled, so the array does not have to be filled
+  setLayout =
+      ZxDescriptorSetLayout::Builder(zxDevice)
+          .addBinding(
+              TEXTURE_BINDING,
+              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+              VK_SHADER_STAGE_FRAGMENT_BIT,
+              capacity,
+              VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                  VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                  VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+          .build();
+  pool =
+      ZxDescriptorPool::Builder(zxDevice)
+          .setMaxSets(1)
+          .setUpdateAfterBind()
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity)
+          .build();
+  if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+    panic("Failed to allocate the bindless descriptor set!");
+  }
+
+  createDefaultTexture();
+  info("Bindless set: " + std::to_string(capacity) + " texture slots", 0);
+}
+
+void ZxBindlessSet::createDefaultTexture() {
+  const uint8_t texel[4] = {255, 255, 255, 255};
+  TextureData data{};
+  data.stagingBuffer = std::make_unique<ZxBuffer>(
+      zxDevice,
+      sizeof(texel),
+      1,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  data.stagingBuffer->map();
+  data.stagingBuffer->writeToBuffer((void *)texel);
+  data.width = 1;
+  data.height = 1;
+  data.levelOffsets = {0};
+  defaultTexture = std::make_unique<Texture>(zxDevice, data);
+
+  uint32_t slot = addTexture(*defaultTexture);
+  assert(slot == DEFAULT_TEXTURE && "The default texture has to take the first slot!");
+}
+
+uint32_t ZxBindlessSet::addTexture(Texture &texture) {
+  if (textureCount == capacity) {
+    panic("Bindless set is out of texture slots!");
+  }
+
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.sampler = texture.getSampler();
+  imageInfo.imageView = texture.getImageView();
+  imageInfo.imageLayout = texture.getImageLayout();
+  ZxDescriptorWriter(*setLayout, *pool)
+      .writeImage(TEXTURE_BINDING, textureCount, &imageInfo)
+      .overwrite(descriptorSet);
+  return textureCount++;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_descriptors.hpp"
+#include "zx_device.hpp"
+#include "zx_texture.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace zx {
+
+// One descriptor set, shared by every frame and pipeline, through which the shaders see
+// every texture at once: a large, partially bound array of combined image samplers indexed
+// by ObjectData::textureIndex, so drawing objects with different textures binds nothing in
+// between. Slots are only ever appended and never rewritten, so adding a texture while
+// earlier frames that sample the other slots are still in flight is allowed by update
+// after bind with VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT.
+class ZxBindlessSet {
+ public:
+  static constexpr uint32_t TEXTURE_BINDING = 0;
+  // lowered to what the device allows in an update after bind set
+  static constexpr uint32_t MAX_TEXTURES = 16384;
+  // slot of a 1x1 white texture, sampled by objects without a texture of their own
+  static constexpr uint32_t DEFAULT_TEXTURE = 0;
+
+  explicit ZxBindlessSet(ZxDevice &device);
+
+  ZxBindlessSet(const ZxBindlessSet &) = delete;
+  ZxBindlessSet &operator=(const ZxBindlessSet &) = delete;
+
+  // writes the texture into the next free slot and returns its index. The texture has to
+  // outlive every frame that samples it
+  uint32_t addTexture(Texture &texture);
+
+  VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+  VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+  uint32_t getTextureCount() const { return textureCount; }
+  uint32_t getCapacity() const { return capacity; }
+
+ private:
+  void createDefaultTexture();
+
+  ZxDevice &zxDevice;
+  uint32_t capacity;
+  uint32_t textureCount = 0;
+  std::unique_ptr<ZxDescriptorSetLayout> setLayout;
+  std::unique_ptr<ZxDescriptorPool> pool;
+  VkDescriptorSet descriptorSet;
+  std::unique_ptr<Texture> defaultTexture;
+};
+}
@@ -105,4 +105,21 @@ void ZxCamera::setViewYXZ(glm::vec3 position, glm::vec3 rotation) {
   inverseViewMatrix[3][2] = position.z;
 }
 
+std::array<glm::vec4, 6> ZxCamera::getFrustumPlanes() const {
+  // Gribb and Hartmann: clip space bounds -w <= x, y <= w and 0 <= z <= w as planes of the
+  // rows of projection * view
+  glm::mat4 m = projectionMatrix * viewMatrix;
+  glm::vec4 row0{m[0][0], m[1][0], m[2][0], m[3][0]};
+  glm::vec4 row1{m[0][1], m[1][1], m[2][1], m[3][1]};
+  glm::vec4 row2{m[0][2], m[1][2], m[2][2], m[3][2]};
+  glm::vec4 row3{m[0][3], m[1][3], m[2][3], m[3][3]};
+
+  std::array<glm::vec4, 6> planes{
+      row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+  for (auto &plane : planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return planes;
+}
+
 }
@@ -6,6 +6,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <array>
+
 namespace zx {
 
 class ZxCamera {
@@ -26,6 +28,10 @@ class ZxCamera {
   const glm::mat4& getInverseView() const { return inverseViewMatrix; }
   const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
 
+  // world space planes (normal, distance) of the view volume, normals pointing inside:
+  // left, right, bottom, top, near, far
+  std::array<glm::vec4, 6> getFrustumPlanes() const;
+
  private:
   glm::mat4 projectionMatrix{1.f};
   glm::mat4 inverseProjectionMatrix{1.f};
@@ -0,0 +1,164 @@
+#include "zx_command_recorder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace zx {
+
+ZxCommandRecorder::ZxCommandRecorder(ZxDevice &device, uint32_t threadCount, int framesInFlight)
+    : zxDevice{device}, threadPools(std::max(threadCount, 1u)) {
+  QueueFamilyIndices queueFamilyIndices = zxDevice.findPhysicalQueueFamilies();
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  for (auto &pools : threadPools) {
+    pools.commandPools.resize(framesInFlight);
+    pools.commandBuffers.resize(framesInFlight);
+    pools.used.resize(framesInFlight);
+    for (auto &commandPool : pools.commandPools) {
+      if (vkCreateCommandPool(zxDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        panic("Failed to create secondary command pool!");
+      }
+    }
+  }
+
+  // thread 0 is the one calling record
+  for (uint32_t thread = 1; thread < threadPools.size(); thread++) {
+    workers.emplace_back([this, thread] { workerLoop(thread); });
+  }
+}
+
+ZxCommandRecorder::~ZxCommandRecorder() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  workCondition.notify_all();
+  for (auto &worker : workers) worker.join();
+
+  for (auto &pools : threadPools) {
+    for (auto &commandPool : pools.commandPools) {
+      // destroying the pool frees its command buffers
+      vkDestroyCommandPool(zxDevice.device(), commandPool, nullptr);
+    }
+  }
+}
+
+void ZxCommandRecorder::beginFrame(int frameIndex) {
+  for (auto &pools : threadPools) {
+    vkResetCommandPool(zxDevice.device(), pools.commandPools[frameIndex], 0);
+    pools.used[frameIndex] = 0;
+  }
+}
+
+std::vector<VkCommandBuffer> ZxCommandRecorder::record(
+    int frameIndex,
+    VkRenderPass renderPass,
+    VkFramebuffer framebuffer,
+    VkExtent2D extent,
+    const std::vector<Job> &jobs) {
+  results.assign(jobs.size(), VK_NULL_HANDLE);
+  if (jobs.empty()) return results;
+
+  inheritanceInfo = VkCommandBufferInheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = framebuffer;
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    currentJobs = &jobs;
+    currentFrame = frameIndex;
+    currentExtent = extent;
+    nextJob = 0;
+    busyWorkers = workers.size();
+    generation++;
+  }
+  workCondition.notify_all();
+
+  runJobs(0);
+
+  std::unique_lock<std::mutex> lock{mutex};
+  doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+  currentJobs = nullptr;
+  return results;
+}
+
+void ZxCommandRecorder::workerLoop(uint32_t thread) {
+  uint64_t seenGeneration = 0;
+  std::unique_lock<std::mutex> lock{mutex};
+  while (true) {
+    workCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+    if (stopping) return;
+    seenGeneration = generation;
+
+    lock.unlock();
+    runJobs(thread);
+    lock.lock();
+
+    if (--busyWorkers == 0) doneCondition.notify_one();
+  }
+}
+
+void ZxCommandRecorder::runJobs(uint32_t thread) {
+  const std::vector<Job> &jobs = *currentJobs;
+  for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+    VkCommandBuffer commandBuffer = acquire(thread);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+      panic("Failed to begin recording secondary command buffer!");
+    }
+
+    // dynamic state is not inherited from the primary
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(currentExtent.width);
+    viewport.height = static_cast<float>(currentExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, currentExtent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    jobs[i](commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+      panic("Failed to record secondary command buffer!");
+    }
+    results[i] = commandBuffer;
+  }
+}
+
+VkCommandBuffer ZxCommandRecorder::acquire(uint32_t thread) {
+  ThreadPools &pools = threadPools[thread];
+  auto &commandBuffers = pools.commandBuffers[currentFrame];
+  size_t &used = pools.used[currentFrame];
+
+  if (used == commandBuffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = pools.commandPools[currentFrame];
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(zxDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+      panic("Failed to allocate secondary command buffer!");
+    }
+    commandBuffers.push_back(commandBuffer);
+  }
+  return commandBuffers[used++];
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_device.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zx {
+
+// Records draw work into secondary command buffers on several threads. Every thread,
+// the calling one included, has its own command pool per frame in flight, so recording
+// needs no locking and a frame's pools are reset in one call once its fence has signalled.
+// The primary executes the returned secondaries inside a render pass begun with
+// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+class ZxCommandRecorder {
+ public:
+  // records into a secondary that already inherits the render pass, viewport and scissor
+  using Job = std::function<void(VkCommandBuffer)>;
+
+  ZxCommandRecorder(ZxDevice &device, uint32_t threadCount, int framesInFlight);
+  ~ZxCommandRecorder();
+
+  ZxCommandRecorder(const ZxCommandRecorder &) = delete;
+  ZxCommandRecorder &operator=(const ZxCommandRecorder &) = delete;
+
+  // recycles the secondaries of a frame index, the previous frame using it must have finished
+  void beginFrame(int frameIndex);
+  // records every job into its own secondary, spread over the threads, and returns them in
+  // job order once all are recorded
+  std::vector<VkCommandBuffer> record(
+      int frameIndex,
+      VkRenderPass renderPass,
+      VkFramebuffer framebuffer,
+      VkExtent2D extent,
+      const std::vector<Job> &jobs);
+
+  uint32_t getThreadCount() const { return static_cast<uint32_t>(threadPools.size()); }
+
+ private:
+  struct ThreadPools {
+    // indexed by frame index
+    std::vector<VkCommandPool> commandPools{};
+    std::vector<std::vector<VkCommandBuffer>> commandBuffers{};
+    std::vector<size_t> used{};
+  };
+
+  void workerLoop(uint32_t thread);
+  void runJobs(uint32_t thread);
+  VkCommandBuffer acquire(uint32_t thread);
+
+  ZxDevice &zxDevice;
+  std::vector<ThreadPools> threadPools;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable workCondition;
+  std::condition_variable doneCondition;
+  uint64_t generation = 0;
+  size_t busyWorkers = 0;
+  bool stopping = false;
+
+  // state of the record call in progress
+  const std::vector<Job> *currentJobs = nullptr;
+  std::vector<VkCommandBuffer> results;
+  std::atomic<size_t> nextJob{0};
+  int currentFrame = 0;
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  VkExtent2D currentExtent{};
+};
+}
@@ -12,7 +12,8 @@ ZxDescriptorSetLayout::Builder &ZxDescriptorSetLayout::Builder::addBinding(
     uint32_t binding,
     VkDescriptorType descriptorType,
     VkShaderStageFlags stageFlags,
-    uint32_t count) {
+    uint32_t count,
+    VkDescriptorBindingFlags flags) {
   assert(bindings.count(binding) == 0 && "Binding already in use");
   VkDescriptorSetLayoutBinding layoutBinding{};
   layoutBinding.binding = binding;
@@ -20,27 +21,50 @@ ZxDescriptorSetLayout::Builder &ZxDescriptorSetLayout::Builder::addBinding(
   layoutBinding.descriptorCount = count;
   layoutBinding.stageFlags = stageFlags;
   bindings[binding] = layoutBinding;
+  if (flags != 0) {
+    bindingFlags[binding] = flags;
+  }
   return *this;
 }
 
 std::unique_ptr<ZxDescriptorSetLayout> ZxDescriptorSetLayout::Builder::build() const {
-  return std::make_unique<ZxDescriptorSetLayout>(zxDevice, bindings);
+  return std::make_unique<ZxDescriptorSetLayout>(zxDevice, bindings, bindingFlags);
 }
 
 // *************** Descriptor Set Layout *********************
 
 ZxDescriptorSetLayout::ZxDescriptorSetLayout(
-    ZxDevice &zxDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+    ZxDevice &zxDevice,
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags)
     : zxDevice{zxDevice}, bindings{bindings} {
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+  // parallel to setLayoutBindings
+  std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
   for (auto kv : bindings) {
     setLayoutBindings.push_back(kv.second);
+    auto flags = bindingFlags.find(kv.first);
+    setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+    if (flags != bindingFlags.end() && (flags->second & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)) {
+      updateAfterBind = true;
+    }
   }
 
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+  bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
   descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
   descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+  if (!bindingFlags.empty()) {
+    descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+  }
+  if (updateAfterBind) {
+    descriptorSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  }
 
   if (vkCreateDescriptorSetLayout(
           zxDevice.device(),
@@ -68,6 +92,11 @@ ZxDescriptorPool::Builder &ZxDescriptorPool::Builder::setPoolFlags(
   poolFlags = flags;
   return *this;
 }
+ZxDescriptorPool::Builder &ZxDescriptorPool::Builder::setUpdateAfterBind() {
+  poolFlags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  return *this;
+}
+
 ZxDescriptorPool::Builder &ZxDescriptorPool::Builder::setMaxSets(uint32_t count) {
   maxSets = count;
   return *this;
@@ -84,7 +113,8 @@ ZxDescriptorPool::ZxDescriptorPool(
     uint32_t maxSets,
     VkDescriptorPoolCreateFlags poolFlags,
     const std::vector<VkDescriptorPoolSize> &poolSizes)
-    : zxDevice{zxDevice} {
+    : zxDevice{zxDevice},
+      updateAfterBind{(poolFlags & VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT) != 0} {
   VkDescriptorPoolCreateInfo descriptorPoolInfo{};
   descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -177,7 +207,30 @@ ZxDescriptorWriter &ZxDescriptorWriter::writeImage(
   return *this;
 }
 
+ZxDescriptorWriter &ZxDescriptorWriter::writeImage(
+    uint32_t binding, uint32_t arrayElement, VkDescriptorImageInfo *imageInfo) {
+  assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+  auto &bindingDescription = setLayout.bindings[binding];
+
+  assert(arrayElement < bindingDescription.descriptorCount && "Array element out of range");
+
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.descriptorType = bindingDescription.descriptorType;
+  write.dstBinding = binding;
+  write.dstArrayElement = arrayElement;
+  write.pImageInfo = imageInfo;
+  write.descriptorCount = 1;
+
+  writes.push_back(write);
+  return *this;
+}
+
 bool ZxDescriptorWriter::build(VkDescriptorSet &set) {
+  assert(
+      (!setLayout.isUpdateAfterBind() || pool.isUpdateAfterBind()) &&
+      "Update after bind layout needs a pool built with setUpdateAfterBind");
   bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
   if (!success) {
     return false;
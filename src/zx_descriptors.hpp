@@ -15,30 +15,38 @@ class ZxDescriptorSetLayout {
    public:
     Builder(ZxDevice &zxDevice) : zxDevice{zxDevice} {}
 
+    // flags with VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT make the layout update after
+    // bind, its sets then have to come from a pool built with the matching flag
     Builder &addBinding(
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count = 1);
+        uint32_t count = 1,
+        VkDescriptorBindingFlags bindingFlags = 0);
     std::unique_ptr<ZxDescriptorSetLayout> build() const;
 
    private:
     ZxDevice &zxDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
   };
 
   ZxDescriptorSetLayout(
-      ZxDevice &zxDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      ZxDevice &zxDevice,
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags = {});
   ~ZxDescriptorSetLayout();
   ZxDescriptorSetLayout(const ZxDescriptorSetLayout &) = delete;
   ZxDescriptorSetLayout &operator=(const ZxDescriptorSetLayout &) = delete;
 
   VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+  bool isUpdateAfterBind() const { return updateAfterBind; }
 
  private:
   ZxDevice &zxDevice;
   VkDescriptorSetLayout descriptorSetLayout;
   std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+  bool updateAfterBind = false;
 
   friend class ZxDescriptorWriter;
 };
@@ -51,6 +59,8 @@ class ZxDescriptorPool {
 
     Builder &addPoolSize(VkDescriptorType descriptorType, uint32_t count);
     Builder &setPoolFlags(VkDescriptorPoolCreateFlags flags);
+    // sets from the pool may be written while bound, needed for update after bind layouts
+    Builder &setUpdateAfterBind();
     Builder &setMaxSets(uint32_t count);
     std::unique_ptr<ZxDescriptorPool> build() const;
 
@@ -77,9 +87,12 @@ class ZxDescriptorPool {
 
   void resetPool();
 
+  bool isUpdateAfterBind() const { return updateAfterBind; }
+
  private:
   ZxDevice &zxDevice;
   VkDescriptorPool descriptorPool;
+  bool updateAfterBind = false;
 
   friend class ZxDescriptorWriter;
 };
@@ -90,6 +103,9 @@ class ZxDescriptorWriter {
 
   ZxDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
   ZxDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+  // one element of an array binding
+  ZxDescriptorWriter &writeImage(
+      uint32_t binding, uint32_t arrayElement, VkDescriptorImageInfo *imageInfo);
 
   bool build(VkDescriptorSet &set);
   void overwrite(VkDescriptorSet &set);
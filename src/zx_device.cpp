@@ -1,13 +1,55 @@
 #include "zx_device.hpp"
 #include "zx_utils.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
 
 namespace zx {
 
+namespace {
+// Written in front of the driver's cache data. The driver checks its own header too, but not
+// every driver rejects data from a different version cleanly, so mismatches are caught here.
+struct PipelineCacheFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t vendorID;
+  uint32_t deviceID;
+  uint32_t driverVersion;
+  uint8_t deviceUUID[VK_UUID_SIZE];
+  uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  // keeps dataSize aligned without padding, the header is compared with memcmp
+  uint32_t reserved;
+  uint64_t dataSize;
+};
+
+constexpr char PIPELINE_CACHE_MAGIC[4] = {'Z', 'X', 'P', 'C'};
+constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+PipelineCacheFileHeader pipelineCacheHeader(VkPhysicalDevice physicalDevice) {
+  VkPhysicalDeviceIDProperties idProperties{};
+  idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &idProperties;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+  PipelineCacheFileHeader header{};
+  std::memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(header.magic));
+  header.version = PIPELINE_CACHE_VERSION;
+  header.vendorID = properties.properties.vendorID;
+  header.deviceID = properties.properties.deviceID;
+  header.driverVersion = properties.properties.driverVersion;
+  std::memcpy(header.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+  std::memcpy(header.pipelineCacheUUID, properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+  return header;
+}
+}  // namespace
+
 // local callback functions
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -54,9 +96,12 @@ ZxDevice::ZxDevice(ZxWindow &window) : window{window} {
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  createPipelineCache();
 }
 
 ZxDevice::~ZxDevice() {
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -142,7 +187,7 @@ void ZxDevice::pickPhysicalDevice() {
   }
 
   if (physicalDevice == VK_NULL_HANDLE) {
-    panic("Failed to find a suitable GPU!");
+    panic("Failed to find a suitable GPU! Descriptor indexing (Vulkan 1.2 or VK_EXT_descriptor_indexing) is required");
   }
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
@@ -170,16 +215,65 @@ void ZxDevice::createLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  multiDrawIndirectEnabled = supportedFeatures.multiDrawIndirect == VK_TRUE;
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  drawIndirectFirstInstanceEnabled = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  presentWaitEnabled = checkPresentWaitSupport(physicalDevice);
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+  presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+  presentWaitFeatures.presentWait = VK_TRUE;
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+  presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  presentIdFeatures.pNext = &presentWaitFeatures;
+  presentIdFeatures.presentId = VK_TRUE;
+  if (presentWaitEnabled) {
+    enabledExtensions.insert(
+        enabledExtensions.end(),
+        presentWaitExtensions.begin(),
+        presentWaitExtensions.end());
+  }
+
+  // required by isDeviceSuitable, only the features the bindless set uses are turned on
+  VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+  descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  descriptorIndexingFeatures.pNext = presentWaitEnabled ? &presentIdFeatures : nullptr;
+  descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+  descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+  if (properties.apiVersion < VK_API_VERSION_1_2) {
+    enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+  }
+
+  VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+  descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties2{};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &descriptorIndexingProperties;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+  // a combined image sampler counts as both a sampler and a sampled image
+  maxBindlessTextures = std::min(
+      {descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+       descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+       descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages});
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext = &descriptorIndexingFeatures;
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -196,6 +290,19 @@ void ZxDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+  if (presentWaitEnabled) {
+    vkWaitForPresent =
+        (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR");
+    presentWaitEnabled = vkWaitForPresent != nullptr;
+  }
+  info(std::string("Present wait: ") + (presentWaitEnabled ? "enabled" : "not supported"), 0);
+  info("Bindless textures: up to " + std::to_string(maxBindlessTextures), 0);
+}
+
+VkResult ZxDevice::waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout) {
+  if (!presentWaitEnabled) return VK_ERROR_EXTENSION_NOT_PRESENT;
+  return vkWaitForPresent(device_, swapChain, presentId, timeout);
 }
 
 void ZxDevice::createCommandPool() {
@@ -212,6 +319,73 @@ void ZxDevice::createCommandPool() {
   }
 }
 
+void ZxDevice::createPipelineCache() {
+  PipelineCacheFileHeader expected = pipelineCacheHeader(physicalDevice);
+  std::vector<char> data;
+
+  std::ifstream file{PIPELINE_CACHE_PATH, std::ios::binary | std::ios::ate};
+  uint64_t fileSize = file ? static_cast<uint64_t>(file.tellg()) : 0;
+  file.seekg(0);
+  PipelineCacheFileHeader header{};
+  if (file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    uint64_t dataSize = header.dataSize;
+    header.dataSize = 0;
+    // a size past the end of the file is a damaged header, never allocate for it
+    if (std::memcmp(&header, &expected, sizeof(header)) == 0 &&
+        dataSize <= fileSize - sizeof(header)) {
+      data.resize(dataSize);
+      if (!file.read(data.data(), static_cast<std::streamsize>(dataSize))) data.clear();
+    }
+    info(
+        data.empty() ? "Pipeline cache is stale, rebuilding"
+                     : "Pipeline cache loaded: " + std::to_string(data.size()) + " bytes",
+        0);
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    // the driver may still refuse data that passed the header check, start empty then
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+      panic("Failed to create pipeline cache!");
+    }
+  }
+}
+
+void ZxDevice::savePipelineCache() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS ||
+      dataSize == 0) {
+    return;
+  }
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, data.data()) != VK_SUCCESS) {
+    return;
+  }
+
+  PipelineCacheFileHeader header = pipelineCacheHeader(physicalDevice);
+  header.dataSize = dataSize;
+
+  // written next to the old file and renamed over it, a crash never leaves a torn cache behind
+  std::string tempPath = std::string{PIPELINE_CACHE_PATH} + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+        !file.write(data.data(), static_cast<std::streamsize>(dataSize))) {
+      info("Failed to write pipeline cache", 0);
+      return;
+    }
+  }
+  if (!replaceFile(tempPath, PIPELINE_CACHE_PATH)) {
+    info("Failed to replace pipeline cache", 0);
+  }
+}
+
 void ZxDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
 bool ZxDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -228,8 +402,21 @@ bool ZxDevice::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+  if (!indices.isComplete() || !extensionsSupported || !swapChainAdequate ||
+      !supportedFeatures.samplerAnisotropy) {
+    return false;
+  }
+
+  // minimum requirement since textures moved to the bindless set, there is no fallback
+  // that binds them one by one
+  if (!checkDescriptorIndexingSupport(device)) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    std::cout << "Rejected device: " << deviceProperties.deviceName
+              << " (descriptor indexing is not supported)" << std::endl;
+    return false;
+  }
+  return true;
 }
 
 void ZxDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -335,6 +522,77 @@ bool ZxDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool ZxDevice::hasDeviceExtension(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      device,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (std::strcmp(extension.extensionName, extensionName) == 0) return true;
+  }
+  return false;
+}
+
+bool ZxDevice::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2 &&
+      !hasDeviceExtension(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+  descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &descriptorIndexingFeatures;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  return descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+         descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+         descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+         descriptorIndexingFeatures.descriptorBindingPartiallyBound &&
+         descriptorIndexingFeatures.runtimeDescriptorArray;
+}
+
+bool ZxDevice::checkPresentWaitSupport(VkPhysicalDevice device) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      device,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  std::set<std::string> requiredExtensions(
+      presentWaitExtensions.begin(),
+      presentWaitExtensions.end());
+  for (const auto &extension : availableExtensions) {
+    requiredExtensions.erase(extension.extensionName);
+  }
+  if (!requiredExtensions.empty()) return false;
+
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+  presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+  presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  presentIdFeatures.pNext = &presentWaitFeatures;
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &presentIdFeatures;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+}
+
 QueueFamilyIndices ZxDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -30,6 +30,9 @@ class ZxDevice {
   const bool enableValidationLayers = true;
 #endif
 
+  // pipeline cache data is kept here between runs
+  static constexpr const char *PIPELINE_CACHE_PATH = "../pipeline_cache.bin";
+
   ZxDevice(ZxWindow &window);
   ~ZxDevice();
 
@@ -44,6 +47,8 @@ class ZxDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // shared by every pipeline, vkCreate*Pipelines may use it from several threads at once
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -53,6 +58,16 @@ class ZxDevice {
 
   VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
 
+  // VK_KHR_present_id and VK_KHR_present_wait are optional, enabled only when both are supported
+  bool isPresentWaitEnabled() const { return presentWaitEnabled; }
+  VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout);
+  // without it every indirect draw has to be issued with its own command
+  bool isMultiDrawIndirectEnabled() const { return multiDrawIndirectEnabled; }
+  // without it indirect draws cannot start past instance 0
+  bool isDrawIndirectFirstInstanceEnabled() const { return drawIndirectFirstInstanceEnabled; }
+  // combined image samplers one update after bind binding may hold, see ZxBindlessSet
+  uint32_t getMaxBindlessTextures() const { return maxBindlessTextures; }
+
   // Buffer Helper Functions
   void createBuffer(
       VkDeviceSize size,
@@ -81,6 +96,9 @@ class ZxDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  // loads PIPELINE_CACHE_PATH if it was written by this device and driver, else starts empty
+  void createPipelineCache();
+  void savePipelineCache();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -90,6 +108,11 @@ class ZxDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool checkPresentWaitSupport(VkPhysicalDevice device);
+  // the descriptor indexing features the bindless set needs, core since Vulkan 1.2 and
+  // VK_EXT_descriptor_indexing before. A minimum requirement, devices without them are rejected
+  bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
+  bool hasDeviceExtension(VkPhysicalDevice device, const char *extensionName);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
@@ -102,9 +125,19 @@ class ZxDevice {
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+
+  bool presentWaitEnabled = false;
+  bool multiDrawIndirectEnabled = false;
+  bool drawIndirectFirstInstanceEnabled = false;
+  uint32_t maxBindlessTextures = 0;
+  PFN_vkWaitForPresentKHR vkWaitForPresent = nullptr;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  const std::vector<const char *> presentWaitExtensions = {
+      VK_KHR_PRESENT_ID_EXTENSION_NAME,
+      VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
 };
 
 }
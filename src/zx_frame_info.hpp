@@ -2,7 +2,7 @@
 
 #include "defines.hpp"
 #include "zx_camera.hpp"
-#include "zx_game_object.hpp"
+#include "zx_scene.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -23,6 +23,8 @@ struct FrameInfo {
   VkCommandBuffer commandBuffer;
   ZxCamera &camera;
   VkDescriptorSet globalDescriptorSet;
-  ZxGameObject::Map &gameObjects;
+  // shared by all frames, see ZxBindlessSet
+  VkDescriptorSet bindlessDescriptorSet;
+  ZxScene &scene;
 };
 }
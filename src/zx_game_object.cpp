@@ -59,20 +59,24 @@ glm::mat3 TransformComponent::normalMatrix() {
   };
 }
 
-ZxGameObject ZxGameObject::makePointLight(float intensity, float radius, glm::vec3 color) {
-  ZxGameObject gameObj = ZxGameObject::createGameObject();
-  gameObj.color = color;
-  gameObj.transform.scale.x = radius;
-  gameObj.pointLight = std::make_unique<PointLightComponent>();
-  gameObj.pointLight->lightIntensity = intensity;
-  return gameObj;
-}
+void TransformComponent::updateMatrices(float c1, float s1, float c2, float s2, float c3, float s3) {
+  // same rotation basis as mat4() and normalMatrix(), scaled by scale and 1 / scale
+  const glm::vec3 basisX{c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1};
+  const glm::vec3 basisY{c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3};
+  const glm::vec3 basisZ{c2 * s1, -s2, c1 * c2};
+  const glm::vec3 invScale = 1.0f / scale;
 
-ZxGameObject ZxGameObject::createChunk(glm::vec3 position){
-  ZxGameObject gameObj = ZxGameObject::createGameObject();
-  gameObj.transform.translation = position;
-  gameObj.transform.scale = {1.f, 1.f, 1.f};
-  return gameObj;
+  cachedMatrix = glm::mat4{
+      glm::vec4{basisX * scale.x, 0.0f},
+      glm::vec4{basisY * scale.y, 0.0f},
+      glm::vec4{basisZ * scale.z, 0.0f},
+      glm::vec4{translation, 1.0f}};
+  cachedNormalMatrix = glm::mat4{
+      glm::vec4{basisX * invScale.x, 0.0f},
+      glm::vec4{basisY * invScale.y, 0.0f},
+      glm::vec4{basisZ * invScale.z, 0.0f},
+      glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+  dirty = false;
 }
 
-}
\ No newline at end of file
+}
@@ -9,7 +9,6 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <memory>
-#include <unordered_map>
 
 namespace zx {
 
@@ -24,44 +23,20 @@ struct TransformComponent {
   glm::mat4 mat4();
 
   glm::mat3 normalMatrix();
+
+  // recomputes the cached matrices from the sines and cosines of rotation.y, .x and .z
+  void updateMatrices(float c1, float s1, float c2, float s2, float c3, float s3);
+
+  // set after changing translation, scale or rotation, the cached matrices are rebuilt by
+  // the next ZxScene::updateTransforms
+  bool dirty = true;
+  glm::mat4 cachedMatrix{1.f};
+  // mat4 so it can be copied straight into the std430 object buffer
+  glm::mat4 cachedNormalMatrix{1.f};
 };
 
 struct PointLightComponent {
   float lightIntensity = 1.0f;
 };
 
-class ZxGameObject {
- public:
-  using id_t = unsigned int;
-  using Map = std::unordered_map<id_t, ZxGameObject>;
-  static ZxGameObject createGameObject() {
-    static id_t currentId = 0;
-    return ZxGameObject{currentId++};
-  }
-
-  static ZxGameObject makePointLight(
-      float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
-      
-  static ZxGameObject createChunk(glm::vec3 position);
-
-  ZxGameObject(const ZxGameObject &) = delete;
-  ZxGameObject &operator=(const ZxGameObject &) = delete;
-  ZxGameObject(ZxGameObject &&) = default;
-  ZxGameObject &operator=(ZxGameObject &&) = default;
-
-  id_t getId() { return id; }
-
-  glm::vec3 color{};
-  TransformComponent transform{};
-
-  // Optional pointer components
-  std::shared_ptr<ZxModel> model{};
-  std::unique_ptr<Chunk> chunk = nullptr;
-  std::unique_ptr<PointLightComponent> pointLight = nullptr;
-
- private:
-  ZxGameObject(id_t objId) : id{objId} {}
-
-  id_t id;
-};
 }
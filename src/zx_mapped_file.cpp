@@ -0,0 +1,99 @@
+#include "zx_mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zx {
+
+ZxMappedFile::~ZxMappedFile() { close(); }
+
+#ifdef _WIN32
+
+bool ZxMappedFile::open(const std::string &filepath) {
+  close();
+
+  HANDLE file = CreateFileA(
+      filepath.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL,
+      nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (mapped == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  fileHandle = file;
+  mappingHandle = mapping;
+  mappedSize = static_cast<size_t>(fileSize.QuadPart);
+  return true;
+}
+
+void ZxMappedFile::close() {
+  if (mapped != nullptr) UnmapViewOfFile(mapped);
+  if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+  if (fileHandle != nullptr) CloseHandle(fileHandle);
+  mapped = nullptr;
+  mappingHandle = nullptr;
+  fileHandle = nullptr;
+  mappedSize = 0;
+}
+
+#else
+
+bool ZxMappedFile::open(const std::string &filepath) {
+  close();
+
+  int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void *address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (address == MAP_FAILED) return false;
+
+  mapped = address;
+  mappedSize = static_cast<size_t>(st.st_size);
+  return true;
+}
+
+void ZxMappedFile::close() {
+  if (mapped != nullptr) munmap(mapped, mappedSize);
+  mapped = nullptr;
+  mappedSize = 0;
+}
+
+#endif
+
+}
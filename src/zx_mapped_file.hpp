@@ -0,0 +1,36 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace zx {
+
+// Read only memory mapping of a whole file.
+class ZxMappedFile {
+ public:
+  ZxMappedFile() = default;
+  ~ZxMappedFile();
+
+  ZxMappedFile(const ZxMappedFile &) = delete;
+  ZxMappedFile &operator=(const ZxMappedFile &) = delete;
+
+  // maps the file at its current size, returns false if it does not exist or is empty
+  bool open(const std::string &filepath);
+  void close();
+
+  bool isOpen() const { return mapped != nullptr; }
+  const uint8_t *data() const { return static_cast<const uint8_t *>(mapped); }
+  size_t size() const { return mappedSize; }
+
+ private:
+  void *mapped = nullptr;
+  size_t mappedSize = 0;
+#ifdef _WIN32
+  void *fileHandle = nullptr;
+  void *mappingHandle = nullptr;
+#endif
+};
+}
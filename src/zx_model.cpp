@@ -1,50 +1,185 @@
 #include "zx_model.hpp"
 
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
 #include "zx_utils.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
-#include <unordered_map>
 #include <iostream>
+#include <thread>
 
 #ifndef ENGINE_DIR
 #define ENGINE_DIR "../"
 #endif
 
-namespace std {
-template <>
-struct hash<zx::ZxModel::Vertex> {
-  size_t operator()(zx::ZxModel::Vertex const &vertex) const {
-    size_t seed = 0;
-    zx::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-    return seed;
+namespace zx {
+
+namespace {
+// Maps tinyobj index triples to the vertex built for them. OBJ files name every corner by
+// its position/normal/texcoord indices, so equal triples are equal vertices and hashing
+// three ints replaces hashing eleven floats. Sized once for the worst case of every corner
+// being unique, at most half full, linear probing.
+class IndexTripleTable {
+ public:
+  explicit IndexTripleTable(size_t maxKeys) {
+    size_t capacity = 16;
+    while (capacity < maxKeys * 2) capacity <<= 1;
+    slots.resize(capacity);
+    mask = capacity - 1;
   }
+
+  // returns the vertex stored for the triple, or stores next for it and sets inserted
+  uint32_t findOrInsert(const tinyobj::index_t &key, uint32_t next, bool &inserted) {
+    for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+      Slot &slot = slots[i];
+      if (slot.value == EMPTY) {
+        slot.key = key;
+        slot.value = next;
+        inserted = true;
+        return next;
+      }
+      if (slot.key.vertex_index == key.vertex_index && slot.key.normal_index == key.normal_index &&
+          slot.key.texcoord_index == key.texcoord_index) {
+        inserted = false;
+        return slot.value;
+      }
+    }
+  }
+
+ private:
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+
+  struct Slot {
+    tinyobj::index_t key{};
+    uint32_t value = EMPTY;
+  };
+
+  static size_t hash(const tinyobj::index_t &key) {
+    uint64_t h = static_cast<uint32_t>(key.vertex_index) * 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<uint32_t>(key.normal_index) * 0xC2B2AE3D27D4EB4Full;
+    h ^= static_cast<uint32_t>(key.texcoord_index) * 0x165667B19E3779F9ull;
+    return static_cast<size_t>(h ^ (h >> 29));
+  }
+
+  std::vector<Slot> slots;
+  size_t mask;
 };
-}  // namespace std
 
-namespace zx {
+struct ShapeMesh {
+  std::vector<ZxModel::Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
 
-ZxModel::ZxModel(ZxDevice &device, const ZxModel::Builder &builder) : zxDevice{device} {
-  createVertexBuffers(builder.vertices);
-  createIndexBuffers(builder.indices);
+ZxModel::Vertex makeVertex(const tinyobj::attrib_t &attrib, const tinyobj::index_t &index) {
+  ZxModel::Vertex vertex{};
+
+  if (index.vertex_index >= 0) {
+    vertex.position = {
+        attrib.vertices[3 * index.vertex_index + 0],
+        attrib.vertices[3 * index.vertex_index + 1],
+        attrib.vertices[3 * index.vertex_index + 2],
+    };
+
+    vertex.color = {
+        attrib.colors[3 * index.vertex_index + 0],
+        attrib.colors[3 * index.vertex_index + 1],
+        attrib.colors[3 * index.vertex_index + 2],
+    };
+  }
+
+  if (index.normal_index >= 0) {
+    vertex.normal = {
+        attrib.normals[3 * index.normal_index + 0],
+        attrib.normals[3 * index.normal_index + 1],
+        attrib.normals[3 * index.normal_index + 2],
+    };
+  }
+
+  if (index.texcoord_index >= 0) {
+    vertex.uv = {
+        attrib.texcoords[2 * index.texcoord_index + 0],
+        attrib.texcoords[2 * index.texcoord_index + 1],
+    };
+  }
+  return vertex;
+}
+
+void buildShapeMesh(const tinyobj::attrib_t &attrib, const tinyobj::shape_t &shape, ShapeMesh &mesh) {
+  const auto &shapeIndices = shape.mesh.indices;
+  IndexTripleTable uniqueVertices{shapeIndices.size()};
+  mesh.indices.reserve(shapeIndices.size());
+
+  for (const auto &index : shapeIndices) {
+    bool inserted = false;
+    uint32_t vertexIndex =
+        uniqueVertices.findOrInsert(index, static_cast<uint32_t>(mesh.vertices.size()), inserted);
+    if (inserted) {
+      mesh.vertices.push_back(makeVertex(attrib, index));
+    }
+    mesh.indices.push_back(vertexIndex);
+  }
+}
+}  // namespace
+
+ZxModel::ZxModel(ZxDevice &device, const ZxModel::Builder &builder)
+    : ZxModel{
+          device,
+          builder.vertices.data(),
+          static_cast<uint32_t>(builder.vertices.size()),
+          builder.indices.data(),
+          static_cast<uint32_t>(builder.indices.size()),
+          VK_INDEX_TYPE_UINT32,
+          builder.meshlets.data(),
+          static_cast<uint32_t>(builder.meshlets.size())} {}
+
+ZxModel::ZxModel(
+    ZxDevice &device,
+    const Vertex *vertices,
+    uint32_t vertexCount,
+    const void *indices,
+    uint32_t indexCount,
+    VkIndexType indexType,
+    const Meshlet *meshlets,
+    uint32_t meshletCount)
+    : zxDevice{device} {
+  createVertexBuffers(vertices, vertexCount);
+  createIndexBuffers(indices, indexCount, indexType);
+  createMeshletBuffer(meshlets, meshletCount);
 }
 
 ZxModel::~ZxModel() {}
 
 std::unique_ptr<ZxModel> ZxModel::createModelFromFile(
     ZxDevice &device, const std::string &filepath) {
+  std::string sourcePath = ENGINE_DIR + filepath;
+  std::string cachePath = sourcePath + MeshCache::EXTENSION;
+
+  MeshCache cache{};
+  if (cache.open(sourcePath, cachePath)) {
+    return std::make_unique<ZxModel>(
+        device,
+        cache.vertices(),
+        cache.vertexCount(),
+        cache.indices(),
+        cache.indexCount(),
+        cache.indexType(),
+        cache.meshlets(),
+        cache.meshletCount());
+  }
+
   Builder builder{};
-  builder.loadModel(ENGINE_DIR + filepath);
+  builder.loadModel(sourcePath);
+  MeshCache::write(sourcePath, cachePath, builder);
   return std::make_unique<ZxModel>(device, builder);
 }
 
-void ZxModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
-  vertexCount = static_cast<uint32_t>(vertices.size());
+void ZxModel::createVertexBuffers(const Vertex *vertices, uint32_t count) {
+  vertexCount = count;
   assert(vertexCount >= 3 && "Vertex count must be at least 3");
   VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
   uint32_t vertexSize = sizeof(vertices[0]);
@@ -58,7 +193,7 @@ void ZxModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   };
 
   stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)vertices.data());
+  stagingBuffer.writeToBuffer((void *)vertices);
 
   vertexBuffer = std::make_unique<ZxBuffer>(
       zxDevice,
@@ -70,16 +205,20 @@ void ZxModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   zxDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
 }
 
-void ZxModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
-  indexCount = static_cast<uint32_t>(indices.size());
+void ZxModel::createIndexBuffers(const void *indices, uint32_t count, VkIndexType type) {
+  indexCount = count;
   hasIndexBuffer = indexCount > 0;
 
   if (!hasIndexBuffer) {
     return;
   }
 
-  VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-  uint32_t indexSize = sizeof(indices[0]);
+  indexType = indexTypeFor(vertexCount);
+  assert(
+      (type == VK_INDEX_TYPE_UINT32 || indexType == VK_INDEX_TYPE_UINT16) &&
+      "16 bit indices cannot address every vertex!");
+  uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * indexCount;
 
   ZxBuffer stagingBuffer{
       zxDevice,
@@ -90,7 +229,16 @@ void ZxModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
   };
 
   stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)indices.data());
+  if (type == indexType) {
+    stagingBuffer.writeToBuffer((void *)indices);
+  } else {
+    // narrowed while writing the staging buffer
+    const auto *source = static_cast<const uint32_t *>(indices);
+    auto *shortIndices = static_cast<uint16_t *>(stagingBuffer.getMappedMemory());
+    for (uint32_t i = 0; i < indexCount; i++) {
+      shortIndices[i] = static_cast<uint16_t>(source[i]);
+    }
+  }
 
   indexBuffer = std::make_unique<ZxBuffer>(
       zxDevice,
@@ -102,11 +250,54 @@ void ZxModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
   zxDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
 }
 
-void ZxModel::draw(VkCommandBuffer commandBuffer) {
+void ZxModel::createMeshletBuffer(const Meshlet *meshlets, uint32_t count) {
+  meshletCount = hasIndexBuffer ? count : 0;
+  if (meshletCount == 0) {
+    return;
+  }
+
+  uint32_t meshletSize = sizeof(meshlets[0]);
+  ZxBuffer stagingBuffer{
+      zxDevice,
+      meshletSize,
+      meshletCount,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+  };
+
+  stagingBuffer.map();
+  stagingBuffer.writeToBuffer((void *)meshlets);
+
+  meshletBuffer = std::make_unique<ZxBuffer>(
+      zxDevice,
+      meshletSize,
+      meshletCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  zxDevice.copyBuffer(
+      stagingBuffer.getBuffer(),
+      meshletBuffer->getBuffer(),
+      static_cast<VkDeviceSize>(meshletSize) * meshletCount);
+}
+
+void ZxModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
   if (hasIndexBuffer) {
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+    vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
   } else {
-    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
+  }
+}
+
+void ZxModel::drawIndirect(
+    VkCommandBuffer commandBuffer, VkBuffer commands, VkDeviceSize offset, uint32_t drawCount) {
+  constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  if (zxDevice.isMultiDrawIndirectEnabled()) {
+    vkCmdDrawIndexedIndirect(commandBuffer, commands, offset, drawCount, stride);
+    return;
+  }
+  for (uint32_t i = 0; i < drawCount; i++) {
+    vkCmdDrawIndexedIndirect(commandBuffer, commands, offset + i * stride, 1, stride);
   }
 }
 
@@ -116,7 +307,7 @@ void ZxModel::bind(VkCommandBuffer commandBuffer) {
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
   if (hasIndexBuffer) {
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
   }
 }
 
@@ -151,47 +342,50 @@ void ZxModel::Builder::loadModel(const std::string &filepath) {
 
   vertices.clear();
   indices.clear();
+  meshlets.clear();
+
+  // shapes are deduplicated independently, a vertex shared by two shapes is stored twice
+  std::vector<ShapeMesh> shapeMeshes(shapes.size());
+  std::atomic<size_t> nextShape{0};
+  auto work = [&] {
+    for (size_t i = nextShape++; i < shapes.size(); i = nextShape++) {
+      buildShapeMesh(attrib, shapes[i], shapeMeshes[i]);
+    }
+  };
+  size_t threadCount =
+      std::min<size_t>(shapes.size(), std::max(std::thread::hardware_concurrency(), 1u));
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threadCount; t++) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto &worker : workers) worker.join();
+
+  size_t vertexTotal = 0;
+  size_t indexTotal = 0;
+  for (const auto &mesh : shapeMeshes) {
+    vertexTotal += mesh.vertices.size();
+    indexTotal += mesh.indices.size();
+  }
+  vertices.reserve(vertexTotal);
+  indices.reserve(indexTotal);
+  for (const auto &mesh : shapeMeshes) {
+    uint32_t base = static_cast<uint32_t>(vertices.size());
+    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    for (uint32_t index : mesh.indices) {
+      indices.push_back(base + index);
+    }
+  }
 
-  std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-  for (const auto &shape : shapes) {
-    for (const auto &index : shape.mesh.indices) {
-      Vertex vertex{};
-
-      if (index.vertex_index >= 0) {
-        vertex.position = {
-            attrib.vertices[3 * index.vertex_index + 0],
-            attrib.vertices[3 * index.vertex_index + 1],
-            attrib.vertices[3 * index.vertex_index + 2],
-        };
-
-        vertex.color = {
-            attrib.colors[3 * index.vertex_index + 0],
-            attrib.colors[3 * index.vertex_index + 1],
-            attrib.colors[3 * index.vertex_index + 2],
-        };
-      }
-
-      if (index.normal_index >= 0) {
-        vertex.normal = {
-            attrib.normals[3 * index.normal_index + 0],
-            attrib.normals[3 * index.normal_index + 1],
-            attrib.normals[3 * index.normal_index + 2],
-        };
-      }
-
-      if (index.texcoord_index >= 0) {
-        vertex.uv = {
-            attrib.texcoords[2 * index.texcoord_index + 0],
-            attrib.texcoords[2 * index.texcoord_index + 1],
-        };
-      }
+  MeshOptimizer::Stats stats = MeshOptimizer::optimize(vertices, indices, true);
+  info(
+      filepath + ": ACMR " + std::to_string(stats.acmrBefore) + " -> " +
+          std::to_string(stats.acmrAfter),
+      0);
 
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-        vertices.push_back(vertex);
-      }
-      indices.push_back(uniqueVertices[vertex]);
-    }
+  if (indices.size() / 3 >= MIN_MESHLET_TRIANGLES) {
+    meshlets = MeshOptimizer::buildMeshlets(vertices, indices);
+    info(filepath + ": " + std::to_string(meshlets.size()) + " meshlets", 0);
   }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defines.hpp"
+#include "mesh_optimizer.hpp"
 #include "zx_buffer.hpp"
 #include "zx_device.hpp"
 
@@ -32,25 +33,58 @@ class ZxModel {
   struct Builder {
     std::vector<Vertex> vertices{};
     std::vector<uint32_t> indices{};
+    // empty for meshes below MIN_MESHLET_TRIANGLES
+    std::vector<Meshlet> meshlets{};
 
     void loadModel(const std::string &filepath);
   };
 
   ZxModel(ZxDevice &device, const ZxModel::Builder &builder);
+  // uploads the arrays as they are, e.g. straight out of a mapped mesh cache; 32 bit
+  // indices are narrowed to 16 bit on upload when the vertex count allows it
+  ZxModel(
+      ZxDevice &device,
+      const Vertex *vertices,
+      uint32_t vertexCount,
+      const void *indices,
+      uint32_t indexCount,
+      VkIndexType indexType,
+      const Meshlet *meshlets = nullptr,
+      uint32_t meshletCount = 0);
+
+  // largest vertex count addressable with 16 bit indices
+  static constexpr uint32_t MAX_SHORT_INDEX_VERTICES = 65536;
+  static VkIndexType indexTypeFor(uint32_t vertexCount) {
+    return vertexCount <= MAX_SHORT_INDEX_VERTICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  }
+  // smaller meshes are drawn whole, culling their few meshlets costs more than it saves
+  static constexpr uint32_t MIN_MESHLET_TRIANGLES = 4096;
   ~ZxModel();
 
   ZxModel(const ZxModel &) = delete;
   ZxModel &operator=(const ZxModel &) = delete;
 
+  // loads the binary mesh cache next to the file when it is up to date, else imports the
+  // file and writes the cache for the next run
   static std::unique_ptr<ZxModel> createModelFromFile(
       ZxDevice &device, const std::string &filepath);
 
   void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  // instances read their per instance attributes starting at firstInstance
+  void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+  // draws drawCount VkDrawIndexedIndirectCommands read from commands at offset
+  void drawIndirect(
+      VkCommandBuffer commandBuffer, VkBuffer commands, VkDeviceSize offset, uint32_t drawCount);
+
+  bool hasMeshlets() const { return meshletCount > 0; }
+  uint32_t getMeshletCount() const { return meshletCount; }
+  // storage buffer of Meshlet, read by the culling shader
+  VkDescriptorBufferInfo meshletInfo() { return meshletBuffer->descriptorInfo(); }
 
  private:
-  void createVertexBuffers(const std::vector<Vertex> &vertices);
-  void createIndexBuffers(const std::vector<uint32_t> &indices);
+  void createVertexBuffers(const Vertex *vertices, uint32_t count);
+  void createIndexBuffers(const void *indices, uint32_t count, VkIndexType type);
+  void createMeshletBuffer(const Meshlet *meshlets, uint32_t count);
 
   ZxDevice &zxDevice;
 
@@ -60,5 +94,9 @@ class ZxModel {
   bool hasIndexBuffer = false;
   std::unique_ptr<ZxBuffer> indexBuffer;
   uint32_t indexCount;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+  std::unique_ptr<ZxBuffer> meshletBuffer;
+  uint32_t meshletCount = 0;
 };
 }
@@ -112,7 +112,7 @@ void ZxPipeline::createGraphicsPipeline(
 
   if (vkCreateGraphicsPipelines(
           zxDevice.device(),
-          VK_NULL_HANDLE,
+          zxDevice.pipelineCache(),
           1,
           &pipelineInfo,
           nullptr,
@@ -136,6 +136,54 @@ void ZxPipeline::bind(VkCommandBuffer commandBuffer) {
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 }
 
+ZxComputePipeline::ZxComputePipeline(
+    ZxDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+    : zxDevice{device} {
+  assert(
+      pipelineLayout != VK_NULL_HANDLE &&
+      "Cannot create compute pipeline: no pipelineLayout provided");
+
+  auto compCode = ZxPipeline::readFile(compFilepath);
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = compCode.size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t*>(compCode.data());
+  if (vkCreateShaderModule(zxDevice.device(), &moduleInfo, nullptr, &compShaderModule) !=
+      VK_SUCCESS) {
+    panic("Failed to create shader module");
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = compShaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+  pipelineInfo.basePipelineIndex = -1;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  if (vkCreateComputePipelines(
+          zxDevice.device(),
+          zxDevice.pipelineCache(),
+          1,
+          &pipelineInfo,
+          nullptr,
+          &computePipeline) != VK_SUCCESS) {
+    panic("Failed to create compute pipeline");
+  }
+}
+
+ZxComputePipeline::~ZxComputePipeline() {
+  vkDestroyShaderModule(zxDevice.device(), compShaderModule, nullptr);
+  vkDestroyPipeline(zxDevice.device(), computePipeline, nullptr);
+}
+
+void ZxComputePipeline::bind(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
 void ZxPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo, std::vector<VkVertexInputBindingDescription> binding_descriptions, std::vector<VkVertexInputAttributeDescription> attribute_descriptions) {
   configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
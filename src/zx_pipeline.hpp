@@ -46,9 +46,9 @@ class ZxPipeline {
   static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo, std::vector<VkVertexInputBindingDescription> binding_descriptions, std::vector<VkVertexInputAttributeDescription> attribute_descriptions);
   static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 
- private:
   static std::vector<char> readFile(const std::string& filepath);
 
+ private:
   void createGraphicsPipeline(
       const std::string& vertFilepath,
       const std::string& fragFilepath,
@@ -61,4 +61,21 @@ class ZxPipeline {
   VkShaderModule vertShaderModule;
   VkShaderModule fragShaderModule;
 };
+
+class ZxComputePipeline {
+ public:
+  ZxComputePipeline(
+      ZxDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+  ~ZxComputePipeline();
+
+  ZxComputePipeline(const ZxComputePipeline&) = delete;
+  ZxComputePipeline& operator=(const ZxComputePipeline&) = delete;
+
+  void bind(VkCommandBuffer commandBuffer);
+
+ private:
+  ZxDevice& zxDevice;
+  VkPipeline computePipeline;
+  VkShaderModule compShaderModule;
+};
 }
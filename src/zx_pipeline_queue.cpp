@@ -0,0 +1,88 @@
+#include "zx_pipeline_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace zx {
+
+ZxPipelineQueue::ZxPipelineQueue(ZxDevice &device) : zxDevice{device} {}
+
+PipelineConfigInfo &ZxPipelineQueue::add(
+    std::unique_ptr<ZxPipeline> &target,
+    const std::string &vertFilepath,
+    const std::string &fragFilepath) {
+  requests.push_back(
+      Request{&target, vertFilepath, fragFilepath, std::make_unique<PipelineConfigInfo>()});
+  return *requests.back().configInfo;
+}
+
+void ZxPipelineQueue::addCompute(
+    std::unique_ptr<ZxComputePipeline> &target,
+    const std::string &compFilepath,
+    VkPipelineLayout pipelineLayout) {
+  Request request{};
+  request.target = nullptr;
+  request.computeTarget = &target;
+  request.compFilepath = compFilepath;
+  request.computeLayout = pipelineLayout;
+  requests.push_back(std::move(request));
+}
+
+void ZxPipelineQueue::build() {
+  if (requests.empty()) return;
+  auto start = std::chrono::high_resolution_clock::now();
+
+  std::atomic<size_t> nextRequest{0};
+  std::mutex errorMutex;
+  std::exception_ptr error;
+  auto work = [&] {
+    for (size_t i = nextRequest++; i < requests.size(); i = nextRequest++) {
+      Request &request = requests[i];
+      try {
+        if (request.computeTarget) {
+          *request.computeTarget = std::make_unique<ZxComputePipeline>(
+              zxDevice, request.compFilepath, request.computeLayout);
+        } else {
+          *request.target = std::make_unique<ZxPipeline>(
+              zxDevice,
+              request.vertFilepath,
+              request.fragFilepath,
+              *request.configInfo);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{errorMutex};
+        if (!error) error = std::current_exception();
+      }
+    }
+  };
+
+  // the calling thread compiles as well
+  size_t threadCount =
+      std::min<size_t>(requests.size(), std::max(std::thread::hardware_concurrency(), 1u));
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threadCount; t++) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto &worker : workers) worker.join();
+
+  size_t built = requests.size();
+  requests.clear();
+  if (error) std::rethrow_exception(error);
+
+  float buildTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                        std::chrono::high_resolution_clock::now() - start)
+                        .count();
+  info(
+      std::to_string(built) + " pipelines built on " + std::to_string(threadCount) +
+          " threads in " + std::to_string(buildTime) + " ms",
+      0);
+}
+
+}
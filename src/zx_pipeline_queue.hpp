@@ -0,0 +1,55 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_device.hpp"
+#include "zx_pipeline.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace zx {
+
+// Collects pipelines while the render systems are being set up and compiles them all at once
+// on worker threads. Shader module and pipeline creation may run concurrently on one device
+// and the device's pipeline cache synchronizes itself, so startup scales with the number of
+// cores instead of the number of pipelines.
+class ZxPipelineQueue {
+ public:
+  explicit ZxPipelineQueue(ZxDevice &device);
+
+  ZxPipelineQueue(const ZxPipelineQueue &) = delete;
+  ZxPipelineQueue &operator=(const ZxPipelineQueue &) = delete;
+
+  // returns the config to fill in, it stays at the same address until build, so its internal
+  // pointers remain valid; target receives the pipeline and must outlive the build call
+  PipelineConfigInfo &add(
+      std::unique_ptr<ZxPipeline> &target,
+      const std::string &vertFilepath,
+      const std::string &fragFilepath);
+  void addCompute(
+      std::unique_ptr<ZxComputePipeline> &target,
+      const std::string &compFilepath,
+      VkPipelineLayout pipelineLayout);
+
+  // compiles every queued pipeline and empties the queue, rethrows the first failure
+  void build();
+
+  size_t size() const { return requests.size(); }
+
+ private:
+  // graphics requests set target and configInfo, compute requests computeTarget
+  struct Request {
+    std::unique_ptr<ZxPipeline> *target;
+    std::string vertFilepath;
+    std::string fragFilepath;
+    std::unique_ptr<PipelineConfigInfo> configInfo;
+    std::unique_ptr<ZxComputePipeline> *computeTarget = nullptr;
+    std::string compFilepath;
+    VkPipelineLayout computeLayout = VK_NULL_HANDLE;
+  };
+
+  ZxDevice &zxDevice;
+  std::vector<Request> requests;
+};
+}
@@ -1,18 +1,28 @@
 #include "zx_renderer.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
+#include <thread>
 
 namespace zx {
 
-ZxRenderer::ZxRenderer(ZxWindow& window, ZxDevice& device)
-    : zxWindow{window}, zxDevice{device} {
+ZxRenderer::ZxRenderer(ZxWindow& window, ZxDevice& device, int framesInFlight)
+    : zxWindow{window},
+      zxDevice{device},
+      framesInFlight{std::clamp(framesInFlight, 1, ZxSwapChain::MAX_FRAMES_IN_FLIGHT)} {
   recreateSwapChain();
   createCommandBuffers();
+  createTimestampQueries();
 }
 
-ZxRenderer::~ZxRenderer() { freeCommandBuffers(); }
+ZxRenderer::~ZxRenderer() {
+  if (timestampPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(zxDevice.device(), timestampPool, nullptr);
+  }
+  freeCommandBuffers();
+}
 
 void ZxRenderer::recreateSwapChain() {
   auto extent = zxWindow.getExtent();
@@ -23,10 +33,10 @@ void ZxRenderer::recreateSwapChain() {
   vkDeviceWaitIdle(zxDevice.device());
 
   if (zxSwapChain == nullptr) {
-    zxSwapChain = std::make_unique<ZxSwapChain>(zxDevice, extent);
+    zxSwapChain = std::make_unique<ZxSwapChain>(zxDevice, extent, framesInFlight);
   } else {
     std::shared_ptr<ZxSwapChain> oldSwapChain = std::move(zxSwapChain);
-    zxSwapChain = std::make_unique<ZxSwapChain>(zxDevice, extent, oldSwapChain);
+    zxSwapChain = std::make_unique<ZxSwapChain>(zxDevice, extent, framesInFlight, oldSwapChain);
 
     if (!oldSwapChain->compareSwapFormats(*zxSwapChain.get())) {
       panic("Swap chain image(or depth) format has changed!");
@@ -35,7 +45,7 @@ void ZxRenderer::recreateSwapChain() {
 }
 
 void ZxRenderer::createCommandBuffers() {
-  commandBuffers.resize(ZxSwapChain::MAX_FRAMES_IN_FLIGHT);
+  commandBuffers.resize(framesInFlight);
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -58,9 +68,99 @@ void ZxRenderer::freeCommandBuffers() {
   commandBuffers.clear();
 }
 
+void ZxRenderer::createTimestampQueries() {
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(zxDevice.getPhysicalDevice(), &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(zxDevice.getPhysicalDevice(), &familyCount, families.data());
+
+  uint32_t validBits = families[zxDevice.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+  if (validBits == 0 || zxDevice.properties.limits.timestampPeriod <= 0.f) {
+    info("Graphics queue has no timestamps, frame pacing measures the GPU with the fence", 0);
+    return;
+  }
+  timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1ull;
+  timestampPeriod = zxDevice.properties.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = static_cast<uint32_t>(framesInFlight) * 2;
+  if (vkCreateQueryPool(zxDevice.device(), &poolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+    panic("Failed to create timestamp query pool!");
+  }
+}
+
+bool ZxRenderer::readLastGpuTime(float &seconds) {
+  if (timestampPool == VK_NULL_HANDLE) return false;
+
+  // the fence of that frame has been waited on, so its results are there without waiting
+  uint32_t lastFrame = static_cast<uint32_t>((currentFrameIndex + framesInFlight - 1) % framesInFlight);
+  std::array<uint64_t, 2> ticks{};
+  if (vkGetQueryPoolResults(
+          zxDevice.device(),
+          timestampPool,
+          lastFrame * 2,
+          2,
+          sizeof(ticks),
+          ticks.data(),
+          sizeof(uint64_t),
+          VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return false;
+  }
+  uint64_t elapsed = (ticks[1] - ticks[0]) & timestampMask;
+  seconds = static_cast<float>(static_cast<double>(elapsed) * timestampPeriod * 1e-9);
+  return true;
+}
+
+void ZxRenderer::setFramePacing(FramePacing pacing, bool sleepToDeadline) {
+  framePacing = pacing;
+  this->sleepToDeadline = sleepToDeadline;
+  hasPacingHistory = false;
+  lastFrameDoneTime = Clock::time_point{};
+}
+
+void ZxRenderer::paceFrame() {
+  // a present that never completes (minimized window on some drivers) must not hang the loop
+  constexpr uint64_t PRESENT_WAIT_TIMEOUT = 100'000'000;
+  constexpr float SLACK = 0.001f;
+
+  // the GPU time must not include waiting for vsync, or nothing is ever left to sleep. It
+  // comes from the timestamps around the last frame's commands, without them from submit
+  // to fence completion, sampled before the present wait
+  zxSwapChain->waitForLastSubmit();
+  auto fenceDone = Clock::now();
+  if (zxDevice.isPresentWaitEnabled()) {
+    // keep at most one frame queued for display while the next one is recorded
+    zxSwapChain->waitForPresent(zxSwapChain->getLastPresentId() - 1, PRESENT_WAIT_TIMEOUT);
+  }
+
+  auto done = Clock::now();
+  if (hasPacingHistory) {
+    auto seconds = [](Clock::duration d) { return std::chrono::duration<float>(d).count(); };
+    float gpuTime;
+    if (!readLastGpuTime(gpuTime)) gpuTime = seconds(fenceDone - lastSubmitTime);
+    gpuTimeEstimate += (gpuTime - gpuTimeEstimate) * PACING_SMOOTHING;
+    frameIntervalEstimate +=
+        (seconds(done - lastFrameDoneTime) - frameIntervalEstimate) * PACING_SMOOTHING;
+
+    // When GPU bound the interval is cpu + gpu and nothing is left to sleep, when the display
+    // limits the rate the spare time is spent here instead of with stale input in acquire.
+    float sleep = frameIntervalEstimate - cpuTimeEstimate - gpuTimeEstimate - SLACK;
+    if (sleepToDeadline && sleep > 0.f) {
+      std::this_thread::sleep_for(std::chrono::duration<float>(sleep));
+    }
+  }
+  lastFrameDoneTime = done;
+}
+
 VkCommandBuffer ZxRenderer::beginFrame() {
   assert(!isFrameStarted && "Can't call beginFrame while already in progress");
 
+  if (framePacing == FramePacing::lowLatency) {
+    paceFrame();
+  }
+
   auto result = zxSwapChain->acquireNextImage(&currentImageIndex);
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     recreateSwapChain();
@@ -72,6 +172,7 @@ VkCommandBuffer ZxRenderer::beginFrame() {
   }
 
   isFrameStarted = true;
+  frameBeginTime = Clock::now();
 
   auto commandBuffer = getCurrentCommandBuffer();
   VkCommandBufferBeginInfo beginInfo{};
@@ -80,17 +181,34 @@ VkCommandBuffer ZxRenderer::beginFrame() {
   if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
     panic("Failed to begin recording command buffer!");
   }
+  if (timestampPool != VK_NULL_HANDLE) {
+    uint32_t firstQuery = static_cast<uint32_t>(currentFrameIndex) * 2;
+    vkCmdResetQueryPool(commandBuffer, timestampPool, firstQuery, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, firstQuery);
+  }
   return commandBuffer;
 }
 
 void ZxRenderer::endFrame() {
   assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
   auto commandBuffer = getCurrentCommandBuffer();
+  if (timestampPool != VK_NULL_HANDLE) {
+    uint32_t firstQuery = static_cast<uint32_t>(currentFrameIndex) * 2;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, firstQuery + 1);
+  }
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     panic("Failed to record command buffer!");
   }
 
   auto result = zxSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+  lastSubmitTime = Clock::now();
+  float cpuTime = std::chrono::duration<float>(lastSubmitTime - frameBeginTime).count();
+  if (hasPacingHistory) {
+    cpuTimeEstimate += (cpuTime - cpuTimeEstimate) * PACING_SMOOTHING;
+  } else {
+    cpuTimeEstimate = cpuTime;
+    hasPacingHistory = lastFrameDoneTime != Clock::time_point{};
+  }
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
       zxWindow.wasWindowResized()) {
     zxWindow.resetWindowResizedFlag();
@@ -100,10 +218,10 @@ void ZxRenderer::endFrame() {
   }
 
   isFrameStarted = false;
-  currentFrameIndex = (currentFrameIndex + 1) % ZxSwapChain::MAX_FRAMES_IN_FLIGHT;
+  currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
 }
 
-void ZxRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void ZxRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
   assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
   assert(
       commandBuffer == getCurrentCommandBuffer() &&
@@ -123,7 +241,8 @@ void ZxRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) return;
 
   VkViewport viewport{};
   viewport.x = 0.0f;
@@ -6,13 +6,27 @@
 #include "zx_window.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <vector>
 
 namespace zx {
+
+enum class FramePacing {
+  // the CPU runs up to framesInFlight frames ahead of the GPU
+  throughput,
+  // beginFrame blocks until the previous frame is done (and presented, with present wait), so
+  // input sampled after it is at most about one frame old when it reaches the screen
+  lowLatency,
+};
+
 class ZxRenderer {
  public:
-  ZxRenderer(ZxWindow &window, ZxDevice &device);
+  // framesInFlight is clamped to [1, ZxSwapChain::MAX_FRAMES_IN_FLIGHT]
+  ZxRenderer(
+      ZxWindow &window,
+      ZxDevice &device,
+      int framesInFlight = ZxSwapChain::DEFAULT_FRAMES_IN_FLIGHT);
   ~ZxRenderer();
 
   ZxRenderer(const ZxRenderer &) = delete;
@@ -21,6 +35,14 @@ class ZxRenderer {
   VkRenderPass getSwapChainRenderPass() const { return zxSwapChain->getRenderPass(); }
   float getAspectRatio() const { return zxSwapChain->extentAspectRatio(); }
   bool isFrameInProgress() const { return isFrameStarted; }
+  // number of per frame resources every system has to keep
+  int getFramesInFlight() const { return framesInFlight; }
+  VkExtent2D getSwapChainExtent() const { return zxSwapChain->getSwapChainExtent(); }
+
+  VkFramebuffer getCurrentFramebuffer() const {
+    assert(isFrameStarted && "Cannot get framebuffer when frame not in progress");
+    return zxSwapChain->getFrameBuffer(currentImageIndex);
+  }
 
   VkCommandBuffer getCurrentCommandBuffer() const {
     assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
@@ -32,23 +54,58 @@ class ZxRenderer {
     return currentFrameIndex;
   }
 
+  // sleepToDeadline additionally delays low latency frames so recording ends just when the
+  // GPU is predicted to be ready for them
+  void setFramePacing(FramePacing pacing, bool sleepToDeadline = true);
+  FramePacing getFramePacing() const { return framePacing; }
+
+  // does all the blocking of a frame, sample input after it returns
   VkCommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  // with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass may only execute secondaries,
+  // which have to set their own viewport and scissor
+  void beginSwapChainRenderPass(
+      VkCommandBuffer commandBuffer,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
  private:
   void createCommandBuffers();
   void freeCommandBuffers();
   void recreateSwapChain();
+  void createTimestampQueries();
+  // GPU execution time of the last submitted frame, false without timestamp support
+  bool readLastGpuTime(float &seconds);
+  void paceFrame();
 
   ZxWindow &zxWindow;
   ZxDevice &zxDevice;
   std::unique_ptr<ZxSwapChain> zxSwapChain;
   std::vector<VkCommandBuffer> commandBuffers;
 
+  int framesInFlight;
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
   bool isFrameStarted{false};
+
+  using Clock = std::chrono::steady_clock;
+  static constexpr float PACING_SMOOTHING = 0.1f;
+  FramePacing framePacing{FramePacing::throughput};
+  bool sleepToDeadline{true};
+  // moving averages in seconds used to predict when the next frame should start
+  bool hasPacingHistory{false};
+  float cpuTimeEstimate{0.f};
+  float gpuTimeEstimate{0.f};
+  float frameIntervalEstimate{0.f};
+  Clock::time_point frameBeginTime{};
+  Clock::time_point lastSubmitTime{};
+  Clock::time_point lastFrameDoneTime{};
+
+  // two timestamps per frame in flight bracket its command buffer, null when the graphics
+  // queue has none
+  VkQueryPool timestampPool{VK_NULL_HANDLE};
+  uint64_t timestampMask{0};
+  // nanoseconds per timestamp tick
+  float timestampPeriod{0.f};
 };
 }
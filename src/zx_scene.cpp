@@ -0,0 +1,141 @@
+#include "zx_scene.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace zx {
+
+namespace {
+// Sine and cosine of every angle. std::sin and std::cos are libm calls the compiler can't
+// vectorize, this is plain arithmetic with selects instead of branches, so at -O3 the loop
+// runs four angles per SSE2 / NEON instruction. Within about one ulp of libm for the angle
+// range of a transform: the angle is reduced to [-pi/4, pi/4] around the nearest multiple of
+// pi/2 (with pi/2 split in three parts to keep the reduction exact), then short polynomials
+// give the sine and cosine there and the quadrant picks and flips them.
+void sinCos(const float *angles, float *sines, float *cosines, size_t count) {
+  constexpr float TWO_OVER_PI = 0.636619772f;
+  constexpr float PI_OVER_TWO_1 = 1.5703125f;
+  constexpr float PI_OVER_TWO_2 = 4.837512969970703125e-4f;
+  constexpr float PI_OVER_TWO_3 = 7.54978995489188216e-8f;
+
+  for (size_t k = 0; k < count; k++) {
+    float x = angles[k];
+    float scaled = x * TWO_OVER_PI;
+    int quadrant = static_cast<int>(scaled + (scaled >= 0.f ? 0.5f : -0.5f));
+    float q = static_cast<float>(quadrant);
+    float r = ((x - q * PI_OVER_TWO_1) - q * PI_OVER_TWO_2) - q * PI_OVER_TWO_3;
+
+    float r2 = r * r;
+    float sine = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float cosine = 1.f - 0.5f * r2 +
+                   r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    bool swap = (quadrant & 1) != 0;
+    float s = swap ? cosine : sine;
+    float c = swap ? sine : cosine;
+    sines[k] = (quadrant & 2) ? -s : s;
+    cosines[k] = ((quadrant + 1) & 2) ? -c : c;
+  }
+}
+}  // namespace
+
+Entity ZxScene::createEntity() {
+  if (!freeEntities.empty()) {
+    Entity entity = freeEntities.back();
+    freeEntities.pop_back();
+    return entity;
+  }
+  return nextEntity++;
+}
+
+void ZxScene::destroyEntity(Entity entity) {
+  transforms.remove(entity);
+  colors.remove(entity);
+  models.remove(entity);
+  textures.remove(entity);
+  chunks.remove(entity);
+  pointLights.remove(entity);
+  freeEntities.push_back(entity);
+}
+
+Entity ZxScene::createPointLight(float intensity, float radius, glm::vec3 color) {
+  Entity entity = createEntity();
+  TransformComponent transform{};
+  transform.scale.x = radius;
+  transforms.add(entity, transform);
+  colors.add(entity, color);
+  pointLights.add(entity, PointLightComponent{intensity});
+  return entity;
+}
+
+Entity ZxScene::createChunk(std::unique_ptr<Chunk> chunk) {
+  Entity entity = createEntity();
+  TransformComponent transform{};
+  transform.translation = glm::vec3(chunk->origin);
+  transforms.add(entity, transform);
+  chunks.add(entity, std::move(chunk));
+  return entity;
+}
+
+void ZxScene::updateTransforms() {
+  TransformComponent *data = transforms.data();
+  size_t count = transforms.size();
+
+  dirtyTransforms.clear();
+  for (size_t i = 0; i < count; i++) {
+    if (data[i].dirty) dirtyTransforms.push_back(static_cast<uint32_t>(i));
+  }
+  if (dirtyTransforms.empty()) return;
+
+  // gather the angles of the dirty transforms into one packed array (y, x, z per transform)
+  // so the trig runs as a single vectorized loop over floats
+  size_t angleCount = dirtyTransforms.size() * 3;
+  rotationAngles.resize(angleCount);
+  rotationSines.resize(angleCount);
+  rotationCosines.resize(angleCount);
+  for (size_t k = 0; k < dirtyTransforms.size(); k++) {
+    const glm::vec3 &rotation = data[dirtyTransforms[k]].rotation;
+    rotationAngles[k * 3 + 0] = rotation.y;
+    rotationAngles[k * 3 + 1] = rotation.x;
+    rotationAngles[k * 3 + 2] = rotation.z;
+  }
+
+  sinCos(rotationAngles.data(), rotationSines.data(), rotationCosines.data(), angleCount);
+  const float *sines = rotationSines.data();
+  const float *cosines = rotationCosines.data();
+
+  // composing the matrices stays scalar: it is a handful of multiplies per transform written
+  // into the interleaved TransformComponent, the trig above was the expensive part
+  for (size_t k = 0; k < dirtyTransforms.size(); k++) {
+    data[dirtyTransforms[k]].updateMatrices(
+        cosines[k * 3 + 0],
+        sines[k * 3 + 0],
+        cosines[k * 3 + 1],
+        sines[k * 3 + 1],
+        cosines[k * 3 + 2],
+        sines[k * 3 + 2]);
+  }
+}
+
+void ZxScene::writeObjectData(
+    ObjectData *dst, size_t capacity, const std::vector<uint32_t> &textureIndices) {
+  if (transforms.size() > capacity) {
+    panic("Too many objects for the object buffer!");
+  }
+
+  TransformComponent *data = transforms.data();
+  for (size_t i = 0; i < transforms.size(); i++) {
+    dst[i].modelMatrix = data[i].cachedMatrix;
+    dst[i].normalMatrix = data[i].cachedNormalMatrix;
+    dst[i].textureIndex = 0;
+  }
+  // resolved every frame, a texture that finished loading moves to its own slot
+  textures.forEach([&](Entity entity, uint32_t handle) {
+    if (!transforms.has(entity)) return;
+    assert(handle < textureIndices.size() && "Unknown texture handle");
+    dst[transforms.indexOf(entity)].textureIndex = textureIndices[handle];
+  });
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_game_object.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace zx {
+
+using Entity = uint32_t;
+
+// per object entry of the object storage buffer, indexed by the transform's dense index
+struct ObjectData {
+  glm::mat4 modelMatrix{1.f};
+  glm::mat4 normalMatrix{1.f};
+  // slot of the bindless set the object samples, 0 is the default white texture
+  uint32_t textureIndex = 0;
+  // std430 rounds the array stride up to the mat4 alignment
+  uint32_t padding[3]{};
+};
+static_assert(sizeof(ObjectData) == 144, "ObjectData must match the std430 layout in the shaders");
+
+// Sparse set storage for one component type. Components are packed in a dense array
+// with the entity owning each one alongside, and a sparse array maps an entity to its
+// dense index. Iteration is a linear walk over the dense arrays, removal swaps the last
+// component into the hole so they stay packed.
+template <typename T>
+class ZxComponentPool {
+ public:
+  bool has(Entity entity) const { return entity < sparse.size() && sparse[entity] != INVALID; }
+
+  T &get(Entity entity) {
+    assert(has(entity) && "Entity does not have this component");
+    return components[sparse[entity]];
+  }
+  T *tryGet(Entity entity) { return has(entity) ? &components[sparse[entity]] : nullptr; }
+
+  T &add(Entity entity, T component) {
+    assert(!has(entity) && "Entity already has this component");
+    if (entity >= sparse.size()) sparse.resize(entity + 1, INVALID);
+    sparse[entity] = static_cast<uint32_t>(components.size());
+    entities.push_back(entity);
+    components.push_back(std::move(component));
+    return components.back();
+  }
+
+  void remove(Entity entity) {
+    if (!has(entity)) return;
+    uint32_t index = sparse[entity];
+    Entity last = entities.back();
+    components[index] = std::move(components.back());
+    entities[index] = last;
+    sparse[last] = index;
+    components.pop_back();
+    entities.pop_back();
+    sparse[entity] = INVALID;
+  }
+
+  // dense index of the entity's component, stable until a component of the pool is removed
+  uint32_t indexOf(Entity entity) const {
+    assert(has(entity) && "Entity does not have this component");
+    return sparse[entity];
+  }
+
+  size_t size() const { return components.size(); }
+  Entity entityAt(size_t index) const { return entities[index]; }
+  T &at(size_t index) { return components[index]; }
+  T *data() { return components.data(); }
+
+  template <typename Fn>
+  void forEach(Fn &&fn) {
+    for (size_t i = 0; i < components.size(); i++) fn(entities[i], components[i]);
+  }
+
+ private:
+  static constexpr uint32_t INVALID = ~0u;
+
+  std::vector<uint32_t> sparse;
+  std::vector<Entity> entities;
+  std::vector<T> components;
+};
+
+// Entities and their components. Systems iterate the pool of the component they are
+// about and look up the few others they need by entity.
+class ZxScene {
+ public:
+  ZxScene() = default;
+
+  ZxScene(const ZxScene &) = delete;
+  ZxScene &operator=(const ZxScene &) = delete;
+
+  Entity createEntity();
+  // removes every component of the entity, its id is reused by later entities
+  void destroyEntity(Entity entity);
+
+  Entity createPointLight(
+      float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
+  // chunk entity placed at the chunk origin
+  Entity createChunk(std::unique_ptr<Chunk> chunk);
+
+  // rebuilds the cached matrices of every dirty transform in one batch
+  void updateTransforms();
+  // copies every transform's matrices to dst in dense order, draws use the transform's
+  // dense index as their first instance to find them. textureIndices maps the texture
+  // handles of the textures pool to bindless set slots, see ZxTextureLoader
+  void writeObjectData(ObjectData *dst, size_t capacity, const std::vector<uint32_t> &textureIndices);
+
+  ZxComponentPool<TransformComponent> transforms;
+  ZxComponentPool<glm::vec3> colors;
+  ZxComponentPool<std::shared_ptr<ZxModel>> models;
+  // ZxTextureLoader handle, objects without one sample the default texture
+  ZxComponentPool<uint32_t> textures;
+  ZxComponentPool<std::unique_ptr<Chunk>> chunks;
+  ZxComponentPool<PointLightComponent> pointLights;
+
+ private:
+  Entity nextEntity = 0;
+  std::vector<Entity> freeEntities;
+
+  // scratch of updateTransforms, kept to avoid reallocating every frame
+  std::vector<uint32_t> dirtyTransforms;
+  std::vector<float> rotationAngles;
+  std::vector<float> rotationSines;
+  std::vector<float> rotationCosines;
+};
+}
@@ -10,14 +10,17 @@
 
 namespace zx {
 
-ZxSwapChain::ZxSwapChain(ZxDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+ZxSwapChain::ZxSwapChain(ZxDevice &deviceRef, VkExtent2D extent, int framesInFlight)
+    : device{deviceRef}, windowExtent{extent}, framesInFlight{framesInFlight} {
   init();
 }
 
 ZxSwapChain::ZxSwapChain(
-    ZxDevice &deviceRef, VkExtent2D extent, std::shared_ptr<ZxSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+    ZxDevice &deviceRef,
+    VkExtent2D extent,
+    int framesInFlight,
+    std::shared_ptr<ZxSwapChain> previous)
+    : device{deviceRef}, windowExtent{extent}, framesInFlight{framesInFlight}, oldSwapChain{previous} {
   init();
   oldSwapChain = nullptr;
 }
@@ -55,7 +58,7 @@ ZxSwapChain::~ZxSwapChain() {
   vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
   // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device.device(), inFlightFences[i], nullptr);
@@ -121,13 +124,39 @@ VkResult ZxSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint3
 
   presentInfo.pImageIndices = imageIndex;
 
+  VkPresentIdKHR presentId{};
+  uint64_t nextPresentId = lastPresentId + 1;
+  if (device.isPresentWaitEnabled()) {
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &nextPresentId;
+    presentInfo.pNext = &presentId;
+    lastPresentId = nextPresentId;
+  }
+
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % framesInFlight;
 
   return result;
 }
 
+void ZxSwapChain::waitForLastSubmit() {
+  size_t lastFrame = (currentFrame + framesInFlight - 1) % framesInFlight;
+  // fences start signaled, so this returns at once before the first submit
+  vkWaitForFences(
+      device.device(),
+      1,
+      &inFlightFences[lastFrame],
+      VK_TRUE,
+      std::numeric_limits<uint64_t>::max());
+}
+
+VkResult ZxSwapChain::waitForPresent(uint64_t presentId, uint64_t timeout) {
+  if (presentId == 0 || presentId > lastPresentId) return VK_SUCCESS;
+  return device.waitForPresent(swapChain, presentId, timeout);
+}
+
 void ZxSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
@@ -346,9 +375,9 @@ void ZxSwapChain::createDepthResources() {
 }
 
 void ZxSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  inFlightFences.resize(framesInFlight);
   imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -358,7 +387,7 @@ void ZxSwapChain::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
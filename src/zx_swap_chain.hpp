@@ -13,11 +13,16 @@ namespace zx {
 
 class ZxSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  // frames the CPU may record ahead of the GPU, more trades input latency for throughput
+  static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
+  static constexpr int DEFAULT_FRAMES_IN_FLIGHT = 2;
 
-  ZxSwapChain(ZxDevice &deviceRef, VkExtent2D windowExtent);
+  ZxSwapChain(ZxDevice &deviceRef, VkExtent2D windowExtent, int framesInFlight);
   ZxSwapChain(
-      ZxDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<ZxSwapChain> previous);
+      ZxDevice &deviceRef,
+      VkExtent2D windowExtent,
+      int framesInFlight,
+      std::shared_ptr<ZxSwapChain> previous);
 
   ~ZxSwapChain();
 
@@ -30,6 +35,7 @@ class ZxSwapChain {
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
+  int getFramesInFlight() const { return framesInFlight; }
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
 
@@ -41,6 +47,13 @@ class ZxSwapChain {
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
+  // blocks until the GPU has finished the most recently submitted frame
+  void waitForLastSubmit();
+  // id given to the last present when present wait is enabled, ids start at 1 per swap chain
+  uint64_t getLastPresentId() const { return lastPresentId; }
+  // blocks until the present with that id reached the display, or the timeout in ns expires
+  VkResult waitForPresent(uint64_t presentId, uint64_t timeout);
+
   bool compareSwapFormats(const ZxSwapChain &swapChain) const {
     return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
            swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -77,6 +90,7 @@ class ZxSwapChain {
 
   ZxDevice &device;
   VkExtent2D windowExtent;
+  int framesInFlight;
 
   VkSwapchainKHR swapChain;
   std::shared_ptr<ZxSwapChain> oldSwapChain;
@@ -86,6 +100,7 @@ class ZxSwapChain {
   std::vector<VkFence> inFlightFences;
   std::vector<VkFence> imagesInFlight;
   size_t currentFrame = 0;
+  uint64_t lastPresentId = 0;
 };
 
 }
@@ -1,51 +1,171 @@
 #include "zx_texture.hpp"
 #include "zx_buffer.hpp"
+#include "texture_codec.hpp"
+#include "texture_container.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../external/stb/stb_image.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 
 namespace zx{
   Texture::Texture(ZxDevice &device, const std::string& filepath) : zxDevice{device} {
+    TextureData data = decode(zxDevice, filepath);
+    if (!data.stagingBuffer) {
+      panic("Failed to load texture: " + filepath);
+    }
+    createImage(&data, 1, VK_IMAGE_VIEW_TYPE_2D);
+  }
+
+  Texture::Texture(ZxDevice &device, const TextureData& data) : zxDevice{device} {
+    createImage(&data, 1, VK_IMAGE_VIEW_TYPE_2D);
+  }
+
+  Texture::Texture(ZxDevice &device, const std::vector<std::string>& layerFilepaths) : zxDevice{device} {
+    assert(!layerFilepaths.empty() && "Texture array needs at least one layer!");
+    std::vector<TextureData> layers;
+    for (const auto& filepath : layerFilepaths) {
+      layers.push_back(decode(zxDevice, filepath));
+      const TextureData& layer = layers.back();
+      if (!layer.stagingBuffer) {
+        panic("Failed to load texture: " + filepath);
+      }
+      // a converted layer next to an unconverted one ends up here too
+      if (layer.width != layers[0].width || layer.height != layers[0].height ||
+          layer.format != layers[0].format || layer.levelOffsets.size() != layers[0].levelOffsets.size()) {
+        panic("Texture array layer does not match the first layer: " + filepath);
+      }
+    }
+    createImage(layers.data(), static_cast<uint32_t>(layers.size()), VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+  }
+
+  TextureData Texture::decode(ZxDevice& device, const std::string& filepath) {
+    TextureData data = decodeContainer(device, filepath, filepath + TextureContainer::EXTENSION);
+    if (data.stagingBuffer) {
+      return data;
+    }
+
     int channels;
-    int bytesPerPixel;
-    
-    auto data = stbi_load(filepath.c_str(), &width, &height, &bytesPerPixel, 4);
+    auto pixels = stbi_load(filepath.c_str(), &data.width, &data.height, &channels, 4);
+    if (pixels == nullptr) {
+      return data;
+    }
+
+    data.stagingBuffer = std::make_unique<ZxBuffer>(
+            device,
+            4,
+            static_cast<uint32_t>(data.width*data.height),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    data.stagingBuffer->map();
+    data.stagingBuffer->writeToBuffer(pixels);
+    data.stagingBuffer->unmap();
+    data.format = VK_FORMAT_R8G8B8A8_SRGB;
+    data.levelOffsets = {0};
 
-    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    stbi_image_free(pixels);
+    return data;
+  }
+
+  TextureData Texture::decodeContainer(ZxDevice& device, const std::string& sourcePath, const std::string& containerPath) {
+    TextureData data{};
+    TextureContainer container{};
+    if (!container.open(sourcePath, containerPath)) {
+      return data;
+    }
 
-    ZxBuffer stagingBuffer{
-            zxDevice, 
-            4, 
-            static_cast<uint32_t>(width*height), 
+    // R8G8B8A8 is always sampleable, so this only picks BC1 when the device supports it
+    data.format = VK_FORMAT_R8G8B8A8_SRGB;
+    if (container.format() == TextureContainer::Format::bc1Srgb) {
+      data.format = device.findSupportedFormat(
+          {VK_FORMAT_BC1_RGBA_SRGB_BLOCK, VK_FORMAT_R8G8B8A8_SRGB},
+          VK_IMAGE_TILING_OPTIMAL,
+          VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+              VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+    }
+    bool decodeBlocks = container.format() == TextureContainer::Format::bc1Srgb &&
+                        data.format == VK_FORMAT_R8G8B8A8_SRGB;
+    TextureContainer::Format uploadFormat =
+        decodeBlocks ? TextureContainer::Format::rgba8Srgb : container.format();
+
+    VkDeviceSize size = 0;
+    for (uint32_t l = 0; l < container.levelCount(); l++) {
+      data.levelOffsets.push_back(size);
+      size += TextureContainer::levelSize(uploadFormat, container.levelWidth(l), container.levelHeight(l));
+      size = (size + TextureContainer::LEVEL_ALIGNMENT - 1) / TextureContainer::LEVEL_ALIGNMENT *
+             TextureContainer::LEVEL_ALIGNMENT;
+    }
+
+    data.stagingBuffer = std::make_unique<ZxBuffer>(
+            device,
+            size,
+            1,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    data.stagingBuffer->map();
+    auto staging = static_cast<uint8_t*>(data.stagingBuffer->getMappedMemory());
+    for (uint32_t l = 0; l < container.levelCount(); l++) {
+      if (decodeBlocks) {
+        TextureCodec::decodeBC1(
+            container.levelData(l),
+            container.levelWidth(l),
+            container.levelHeight(l),
+            staging + data.levelOffsets[l]);
+      } else {
+        std::memcpy(staging + data.levelOffsets[l], container.levelData(l), container.levelSize(l));
+      }
+    }
+    data.stagingBuffer->unmap();
+
+    data.width = static_cast<int>(container.width());
+    data.height = static_cast<int>(container.height());
+    return data;
+  }
+
+  void Texture::createImage(const TextureData* layers, uint32_t count, VkImageViewType viewType) {
+    const TextureData& data = layers[0];
+    width = data.width;
+    height = data.height;
+    layerCount = count;
+    // a single level gets a full chain, blitted by generateMipMaps
+    bool generateMips = data.levelOffsets.size() == 1;
+    mipLevels = generateMips
+        ? static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1
+        : static_cast<int>(data.levelOffsets.size());
+
+    imageFormat = data.format;
 
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer(data);
-    
-    imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
-    
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.format = imageFormat;
     imageInfo.mipLevels = mipLevels;
-    imageInfo.arrayLayers = 1;
+    imageInfo.arrayLayers = layerCount;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 };
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (generateMips) {
+      // the blits read the previous level
+      imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
     zxDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
 
     transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    
-    zxDevice.copyBufferToImage(stagingBuffer.getBuffer(), image, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
 
-    generateMipMaps();
+    copyLevels(layers, layerCount);
+    if (generateMips) {
+      generateMipMaps();
+    } else {
+      transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
     imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
@@ -69,19 +189,17 @@ namespace zx{
 
     VkImageViewCreateInfo imageViewInfo {};
       imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-      imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+      imageViewInfo.viewType = viewType;
       imageViewInfo.format = imageFormat;
       imageViewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
       imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
       imageViewInfo.subresourceRange.baseMipLevel = 0;
       imageViewInfo.subresourceRange.baseArrayLayer = 0;
-      imageViewInfo.subresourceRange.layerCount = 1;
+      imageViewInfo.subresourceRange.layerCount = layerCount;
       imageViewInfo.subresourceRange.levelCount = mipLevels;
       imageViewInfo.image = image;
 
       vkCreateImageView(zxDevice.device(), &imageViewInfo, nullptr, &imageView);
-
-      stbi_image_free(data);
   }
 
   Texture::~Texture(){
@@ -91,6 +209,42 @@ namespace zx{
     vkDestroySampler(zxDevice.device(), sampler, nullptr);
   }
 
+  // every layer is recorded into one command buffer, an array costs a single submit and wait
+  void Texture::copyLevels(const TextureData* layers, uint32_t count) {
+    VkCommandBuffer commandBuffer = zxDevice.beginSingleTimeCommands();
+
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t layer = 0; layer < count; layer++) {
+      const TextureData& data = layers[layer];
+      regions.assign(data.levelOffsets.size(), VkBufferImageCopy{});
+      for (uint32_t level = 0; level < regions.size(); level++) {
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = data.levelOffsets[level];
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = layer;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {
+            std::max(static_cast<uint32_t>(width) >> level, 1u),
+            std::max(static_cast<uint32_t>(height) >> level, 1u),
+            1};
+      }
+
+      vkCmdCopyBufferToImage(
+          commandBuffer,
+          data.stagingBuffer->getBuffer(),
+          image,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          static_cast<uint32_t>(regions.size()),
+          regions.data());
+    }
+
+    zxDevice.endSingleTimeCommands(commandBuffer);
+  }
+
   void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout){
     VkCommandBuffer commandBuffer = zxDevice.beginSingleTimeCommands();
     
@@ -105,7 +259,7 @@ namespace zx{
     barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.layerCount = layerCount;
 
     VkPipelineStageFlags srcStage;
     VkPipelineStageFlags dstStage;
@@ -147,7 +301,7 @@ namespace zx{
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.layerCount = layerCount;
     barrier.subresourceRange.levelCount = 1;
 
     int32_t mipWidth = width;
@@ -168,13 +322,13 @@ namespace zx{
       blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
       blit.srcSubresource.mipLevel = i - 1;
       blit.srcSubresource.baseArrayLayer = 0;
-      blit.srcSubresource.layerCount = 1;
+      blit.srcSubresource.layerCount = layerCount;
       blit.dstOffsets[0] = {0, 0, 0};
       blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
       blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
       blit.dstSubresource.mipLevel = i;
       blit.dstSubresource.baseArrayLayer = 0;
-      blit.dstSubresource.layerCount = 1;
+      blit.dstSubresource.layerCount = layerCount;
 
       vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
@@ -1,14 +1,33 @@
 #pragma once
 
 #include "defines.hpp"
+#include "zx_buffer.hpp"
 #include "zx_device.hpp"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace zx{
+  // pixels ready to be copied into an image, as produced by Texture::decode
+  struct TextureData {
+    // null if the file could not be read
+    std::unique_ptr<ZxBuffer> stagingBuffer;
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    int width = 0;
+    int height = 0;
+    // where every mip level starts in the staging buffer; a single level gets the rest of
+    // its chain blitted on the GPU
+    std::vector<VkDeviceSize> levelOffsets{};
+  };
+
   class Texture{
     public:
       Texture(ZxDevice& device, const std::string& filepath);
+      Texture(ZxDevice& device, const TextureData& data);
+      // 2D array texture, one layer per file; the layers must decode to the same size,
+      // format and level count
+      Texture(ZxDevice& device, const std::vector<std::string>& layerFilepaths);
       ~Texture();
 
       Texture(const Texture &) = delete;
@@ -19,12 +38,24 @@ namespace zx{
       VkSampler getSampler() { return sampler; }
       VkImageView getImageView() { return imageView; }
       VkImageLayout getImageLayout() { return imageLayout; }
+      uint32_t getLayerCount() const { return layerCount; }
+
+      // prefers the converted container next to the file (filepath + TextureContainer::EXTENSION)
+      // with its precomputed mips, BC1 compressed when the device can sample that and decoded
+      // on the CPU otherwise; falls back to decoding the file itself with stb_image when there
+      // is no container or the file changed after it was converted.
+      // touches no queue, so it may run on any thread
+      static TextureData decode(ZxDevice& device, const std::string& filepath);
 
     private:
+      static TextureData decodeContainer(ZxDevice& device, const std::string& sourcePath, const std::string& containerPath);
+      void createImage(const TextureData* layers, uint32_t count, VkImageViewType viewType);
+      void copyLevels(const TextureData* layers, uint32_t count);
       void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
       void generateMipMaps();
 
       int width, height, mipLevels;
+      uint32_t layerCount;
       ZxDevice& zxDevice;
       VkImage image;
       VkDeviceMemory imageMemory;
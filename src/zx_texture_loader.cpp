@@ -0,0 +1,105 @@
+#include "zx_texture_loader.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace zx {
+
+ZxTextureLoader::ZxTextureLoader(ZxDevice &device, ZxBindlessSet &bindlessSet)
+    : zxDevice{device}, bindlessSet{bindlessSet} {
+  createPlaceholder();
+  worker = std::thread{&ZxTextureLoader::workerLoop, this};
+}
+
+ZxTextureLoader::~ZxTextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+void ZxTextureLoader::createPlaceholder() {
+  // a single mid grey texel, close to the average of most textures
+  const uint8_t texel[4] = {128, 128, 128, 255};
+  TextureData data{};
+  data.stagingBuffer = std::make_unique<ZxBuffer>(
+      zxDevice,
+      sizeof(texel),
+      1,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  data.stagingBuffer->map();
+  data.stagingBuffer->writeToBuffer((void *)texel);
+  data.width = 1;
+  data.height = 1;
+  data.levelOffsets = {0};
+  placeholder = std::make_unique<Texture>(zxDevice, data);
+  placeholderIndex = bindlessSet.addTexture(*placeholder);
+}
+
+ZxTextureLoader::Handle ZxTextureLoader::load(const std::string &filepath) {
+  Handle handle = static_cast<Handle>(textures.size());
+  textures.emplace_back();
+  textureIndices.push_back(placeholderIndex);
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    requests.push_back(Request{handle, filepath});
+  }
+  wake.notify_one();
+  return handle;
+}
+
+void ZxTextureLoader::workerLoop() {
+  std::unique_lock<std::mutex> lock{mutex};
+  while (true) {
+    wake.wait(lock, [&] { return stopping || !requests.empty(); });
+    if (stopping) return;
+
+    Request request = std::move(requests.front());
+    requests.pop_front();
+    lock.unlock();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Decoded result{request.handle, Texture::decode(zxDevice, request.filepath)};
+    if (result.data.stagingBuffer) {
+      float decodeTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                             std::chrono::high_resolution_clock::now() - start)
+                             .count();
+      info(request.filepath + " decoded in " + std::to_string(decodeTime) + " ms", 0);
+    } else {
+      info("Failed to load texture: " + request.filepath, 1);
+    }
+
+    lock.lock();
+    decoded.push_back(std::move(result));
+  }
+}
+
+uint32_t ZxTextureLoader::update() {
+  uint32_t ready = 0;
+  for (uint32_t i = 0; i < MAX_UPLOADS_PER_FRAME; i++) {
+    Decoded next;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (decoded.empty()) break;
+      next = std::move(decoded.front());
+      decoded.pop_front();
+    }
+    // a texture that failed keeps the placeholder
+    if (!next.data.stagingBuffer) continue;
+
+    textures[next.handle] = std::make_unique<Texture>(zxDevice, next.data);
+    // a fresh slot rather than the placeholder's, frames in flight may still sample that
+    textureIndices[next.handle] = bindlessSet.addTexture(*textures[next.handle]);
+    ready++;
+  }
+  return ready;
+}
+
+Texture &ZxTextureLoader::get(Handle handle) {
+  return textures[handle] ? *textures[handle] : *placeholder;
+}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "defines.hpp"
+#include "zx_bindless_set.hpp"
+#include "zx_buffer.hpp"
+#include "zx_device.hpp"
+#include "zx_texture.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zx {
+
+// Loads textures without holding up the frame loop. A worker thread decodes the files
+// and fills their staging buffers; update, called once per frame on the main thread, only
+// records the copies and mip chains and adds the texture to the bindless set. Until a
+// texture is uploaded get returns a small placeholder and its texture index points at the
+// placeholder's slot.
+class ZxTextureLoader {
+ public:
+  using Handle = uint32_t;
+  // uploads wait for the queue, a few per frame keep the hitch small
+  static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 2;
+
+  ZxTextureLoader(ZxDevice &device, ZxBindlessSet &bindlessSet);
+  // stops the worker, textures still waiting to be decoded are dropped
+  ~ZxTextureLoader();
+
+  ZxTextureLoader(const ZxTextureLoader &) = delete;
+  ZxTextureLoader &operator=(const ZxTextureLoader &) = delete;
+
+  // queues the file for decoding, the handle is valid right away
+  Handle load(const std::string &filepath);
+  // uploads textures the worker has decoded, returns how many became ready
+  uint32_t update();
+
+  // the texture once it is ready, the placeholder before that or if it failed to load
+  Texture &get(Handle handle);
+  bool isReady(Handle handle) const { return textures[handle] != nullptr; }
+  // bindless set slot of every handle, meant to be resolved when the object data is written
+  const std::vector<uint32_t> &getTextureIndices() const { return textureIndices; }
+
+ private:
+  struct Request {
+    Handle handle;
+    std::string filepath;
+  };
+
+  struct Decoded {
+    Handle handle;
+    TextureData data;
+  };
+
+  void createPlaceholder();
+  void workerLoop();
+
+  ZxDevice &zxDevice;
+  ZxBindlessSet &bindlessSet;
+  std::unique_ptr<Texture> placeholder;
+  uint32_t placeholderIndex;
+  // by handle, null until uploaded
+  std::vector<std::unique_ptr<Texture>> textures;
+  std::vector<uint32_t> textureIndices;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Request> requests;
+  std::deque<Decoded> decoded;
+  bool stopping = false;
+  // started last, after everything it uses
+  std::thread worker;
+};
+}
@@ -0,0 +1,20 @@
+#include "zx_utils.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace zx {
+
+bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+  // rename refuses to overwrite on windows, MoveFileEx replaces in one step
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+}
@@ -2,6 +2,7 @@
 
 #include "defines.hpp"
 #include <functional>
+#include <string>
 
 namespace zx {
 
@@ -12,4 +13,7 @@ void hashCombine(std::size_t& seed, const T& v, const Rest&... rest) {
   (hashCombine(seed, rest), ...);
 };
 
+// moves from over to, replacing to atomically so readers see the old or the new file, never neither
+bool replaceFile(const std::string& from, const std::string& to);
+
 }
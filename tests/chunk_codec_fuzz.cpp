@@ -0,0 +1,153 @@
+// ChunkCodec round trip and malformed payload fuzz test.
+// Build with -DZENIX_BUILD_TESTS=ON and run through ctest, or run chunk_codec_fuzz [iterations].
+// Worth running under -fsanitize=address,undefined, a bad payload must fail and never overrun.
+
+#include "chunk_codec.hpp"
+#include "SimplexNoise.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using zx::ChunkCodec;
+
+namespace {
+
+constexpr int SIZE = 32;
+
+int failures = 0;
+
+void fail(const char *what, int iteration) {
+  std::printf("FAILED: %s (iteration %d)\n", what, iteration);
+  failures++;
+}
+
+// same terrain as Chunk::intializeChunk, at a random chunk origin
+std::vector<uint8_t> terrainChunk(std::mt19937 &rng) {
+  std::uniform_int_distribution<int> origin{-4096, 4096};
+  int ox = origin(rng) * SIZE, oz = origin(rng) * SIZE;
+  int oy = std::uniform_int_distribution<int>{-1, 1}(rng) * SIZE / 2;
+  std::vector<uint8_t> types(ChunkCodec::CHUNK_VOLUME);
+  for (int z = 0; z < SIZE; z++) {
+    for (int x = 0; x < SIZE; x++) {
+      float noise = SimplexNoise::noise(static_cast<float>(ox + x), static_cast<float>(oz + z));
+      float height = int(((noise + 1.f) / 2.f) * 32.f) / 2.f;
+      for (int y = 0; y < SIZE; y++) {
+        float wy = static_cast<float>(oy + y);
+        types[(y * SIZE + z) * SIZE + x] = wy < height ? (wy + 1 < height ? 1 : 2) : 0;
+      }
+    }
+  }
+  return types;
+}
+
+// a mix of what the methods are good and bad at, so every method gets picked
+std::vector<uint8_t> randomChunk(std::mt19937 &rng) {
+  std::uniform_int_distribution<int> kind{0, 5};
+  std::uniform_int_distribution<int> byte{0, 255};
+  std::uniform_int_distribution<int> voxel{0, static_cast<int>(ChunkCodec::CHUNK_VOLUME) - 1};
+  std::vector<uint8_t> types;
+  switch (kind(rng)) {
+    case 0:
+      return terrainChunk(rng);
+    case 1: {
+      // terrain with some digging and building, types past the column tag bit included
+      types = terrainChunk(rng);
+      int edits = std::uniform_int_distribution<int>{1, 2000}(rng);
+      for (int i = 0; i < edits; i++) types[voxel(rng)] = static_cast<uint8_t>(byte(rng) % 4 == 0 ? byte(rng) : 0);
+      return types;
+    }
+    case 2:
+      types.resize(ChunkCodec::CHUNK_VOLUME);
+      for (auto &type : types) type = static_cast<uint8_t>(byte(rng));
+      return types;
+    case 3:
+      // flat strata with a few types, long runs along the layers
+      types.resize(ChunkCodec::CHUNK_VOLUME);
+      for (size_t i = 0; i < types.size(); i++) types[i] = static_cast<uint8_t>((i / ChunkCodec::LAYER_SIZE) % 3 + 128);
+      return types;
+    case 4:
+      types.assign(ChunkCodec::CHUNK_VOLUME, static_cast<uint8_t>(byte(rng)));
+      return types;
+    default:
+      // few types with short runs in every direction
+      types.resize(ChunkCodec::CHUNK_VOLUME);
+      for (auto &type : types) type = static_cast<uint8_t>(byte(rng) % 3);
+      return types;
+  }
+}
+
+// damaged payloads only have to fail cleanly or decode to some whole chunk
+void decodeDamaged(const std::vector<uint8_t> &payload, int iteration) {
+  std::vector<uint8_t> types;
+  if (ChunkCodec::decode(payload.data(), payload.size(), types) && types.size() != ChunkCodec::CHUNK_VOLUME) {
+    fail("damaged payload decoded to the wrong size", iteration);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+  std::mt19937 rng{20240531};
+  std::uniform_int_distribution<int> byte{0, 255};
+
+  int methods[4] = {};
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    std::vector<uint8_t> types = randomChunk(rng);
+    std::vector<uint8_t> payload = ChunkCodec::encode(types.data(), types.size());
+    methods[payload[0] % 4]++;
+
+    std::vector<uint8_t> decoded;
+    if (!ChunkCodec::decode(payload.data(), payload.size(), decoded) || decoded != types) {
+      fail("payload does not round trip", iteration);
+    }
+    if (payload.size() > types.size() + 5) fail("payload is bigger than the raw fallback", iteration);
+
+    // truncated, extended, bit flipped and overwritten payloads
+    std::vector<uint8_t> damaged = payload;
+    damaged.resize(std::uniform_int_distribution<size_t>{0, payload.size() - 1}(rng));
+    decodeDamaged(damaged, iteration);
+
+    damaged = payload;
+    damaged.push_back(static_cast<uint8_t>(byte(rng)));
+    decodeDamaged(damaged, iteration);
+
+    std::uniform_int_distribution<size_t> position{0, payload.size() - 1};
+    for (int flips = 1; flips <= 8; flips *= 2) {
+      damaged = payload;
+      for (int i = 0; i < flips; i++) damaged[position(rng)] ^= static_cast<uint8_t>(1u << (byte(rng) % 8));
+      decodeDamaged(damaged, iteration);
+    }
+
+    damaged = payload;
+    for (size_t i = std::uniform_int_distribution<size_t>{5, payload.size()}(rng); i < damaged.size(); i++) {
+      damaged[i] = static_cast<uint8_t>(byte(rng));
+    }
+    decodeDamaged(damaged, iteration);
+  }
+
+  // a header claiming any size other than a chunk is rejected before anything is allocated
+  std::vector<uint8_t> types(ChunkCodec::CHUNK_VOLUME, 1);
+  std::vector<uint8_t> payload = ChunkCodec::encode(types.data(), types.size());
+  for (uint32_t rawSize : {0u, 1u, static_cast<uint32_t>(ChunkCodec::CHUNK_VOLUME) - 1u,
+                           static_cast<uint32_t>(ChunkCodec::CHUNK_VOLUME) + 1u, 0xffffffffu}) {
+    std::vector<uint8_t> damaged = payload;
+    for (int i = 0; i < 4; i++) damaged[1 + i] = static_cast<uint8_t>(rawSize >> (8 * i));
+    std::vector<uint8_t> decoded;
+    if (ChunkCodec::decode(damaged.data(), damaged.size(), decoded)) fail("wrong raw size accepted", -1);
+  }
+
+  // payloads of the plain rle method, which is no longer written, still decode
+  std::vector<uint8_t> legacy = {ChunkCodec::rle, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80, 0x80, 0x02};
+  std::vector<uint8_t> decoded;
+  if (!ChunkCodec::decode(legacy.data(), legacy.size(), decoded) ||
+      decoded != std::vector<uint8_t>(ChunkCodec::CHUNK_VOLUME, 0)) {
+    fail("legacy rle payload does not decode", -1);
+  }
+
+  std::printf("%d chunks: %d columns, %d rleLz, %d raw payloads, %d failures\n", iterations,
+      methods[ChunkCodec::columns], methods[ChunkCodec::rleLz], methods[ChunkCodec::raw], failures);
+  return failures == 0 ? 0 : 1;
+}